@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Helpers shared by the benchmark payloads. They run in S-mode on top of
+ * fw_payload and only talk to the firmware through ecalls; pick one with
+ * FW_PAYLOAD_PATH=<build>/platform/<plat>/firmware/payloads/<name>.bin
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_ecall_interface.h>
+
+struct sbiret {
+	long error;
+	long value;
+};
+
+static inline struct sbiret bench_ecall(unsigned long eid, unsigned long fid,
+					unsigned long arg0, unsigned long arg1,
+					unsigned long arg2, unsigned long arg3)
+{
+	struct sbiret ret;
+	register unsigned long a0 asm("a0") = arg0;
+	register unsigned long a1 asm("a1") = arg1;
+	register unsigned long a2 asm("a2") = arg2;
+	register unsigned long a3 asm("a3") = arg3;
+	register unsigned long a6 asm("a6") = fid;
+	register unsigned long a7 asm("a7") = eid;
+
+	asm volatile("ecall"
+		     : "+r"(a0), "+r"(a1)
+		     : "r"(a2), "r"(a3), "r"(a6), "r"(a7)
+		     : "memory");
+	ret.error = a0;
+	ret.value = a1;
+	return ret;
+}
+
+static inline void bench_puts(const char *str)
+{
+	while (str && *str)
+		bench_ecall(SBI_EXT_0_1_CONSOLE_PUTCHAR, 0, *str++, 0, 0, 0);
+}
+
+static inline void bench_putdec(unsigned long val, int width)
+{
+	char buf[24];
+	int i = sizeof(buf) - 1;
+
+	buf[i] = '\0';
+	do {
+		buf[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+	while (sizeof(buf) - 1 - i < width)
+		buf[--i] = ' ';
+	bench_puts(&buf[i]);
+}
+
+/* ticks / n with two decimals, right aligned in width characters */
+static inline void bench_putavg(unsigned long ticks, unsigned long n,
+				int width)
+{
+	unsigned long centi = ticks * 100 / n;
+
+	bench_putdec(centi / 100, width - 3);
+	bench_puts(centi % 100 < 10 ? ".0" : ".");
+	bench_putdec(centi % 100, 0);
+}
+
+static inline unsigned long bench_time(void)
+{
+	return csr_read(CSR_TIME);
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Ecall round-trip benchmark, one call per extension: the standard
+ * extensions, the legacy range, the vendor range and an ID nothing
+ * registers, which covers both the lookup cache and the range search.
+ */
+
+#include "bench.h"
+
+#define BENCH_WARMUP	16
+#define BENCH_ITERS	10000
+/* Neither standard nor in a reserved range */
+#define BENCH_EXT_UNKNOWN	0x0badc0de
+
+struct bench_call {
+	const char *name;
+	unsigned long eid;
+	unsigned long fid;
+	unsigned long arg0;
+	unsigned long arg1;
+};
+
+static unsigned long bench_run(const struct bench_call *call, long *error)
+{
+	unsigned long i, start = 0;
+	struct sbiret ret = { 0, 0 };
+
+	for (i = 0; i < BENCH_WARMUP + BENCH_ITERS; i++) {
+		if (i == BENCH_WARMUP)
+			start = bench_time();
+		ret = bench_ecall(call->eid, call->fid, call->arg0, call->arg1,
+				  0, 0);
+	}
+	*error = ret.error;
+
+	return bench_time() - start;
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	const struct bench_call calls[] = {
+		{ "base spec_version", SBI_EXT_BASE,
+		  SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0 },
+		{ "base probe_ext   ", SBI_EXT_BASE, SBI_EXT_BASE_PROBE_EXT,
+		  SBI_EXT_TIME, 0 },
+		{ "time set_timer   ", SBI_EXT_TIME, SBI_EXT_TIME_SET_TIMER,
+		  -1UL, 0 },
+		{ "ipi send_ipi     ", SBI_EXT_IPI, SBI_EXT_IPI_SEND_IPI, 0, 0 },
+		{ "rfence fence.i   ", SBI_EXT_RFENCE,
+		  SBI_EXT_RFENCE_REMOTE_FENCE_I, 1UL << a0, 0 },
+		{ "hsm get_status   ", SBI_EXT_HSM, SBI_EXT_HSM_HART_GET_STATUS,
+		  a0, 0 },
+		{ "pmu num_counters ", SBI_EXT_PMU, SBI_EXT_PMU_NUM_COUNTERS, 0,
+		  0 },
+		{ "legacy clear_ipi ", SBI_EXT_0_1_CLEAR_IPI, 0, 0, 0 },
+		{ "vendor           ", SBI_EXT_VENDOR_START, 0, 0, 0 },
+		{ "unknown          ", BENCH_EXT_UNKNOWN, 0, 0, 0 },
+	};
+	unsigned long i, ticks;
+	long error;
+
+	bench_puts("\nEcall round trip, time ticks per call\n");
+	bench_puts("extension          ticks/call  error\n");
+	for (i = 0; i < sizeof(calls) / sizeof(calls[0]); i++) {
+		ticks = bench_run(&calls[i], &error);
+		bench_puts(calls[i].name);
+		bench_putavg(ticks, BENCH_ITERS, 12);
+		bench_puts(error < 0 ? "     -" : "      ");
+		bench_putdec(error < 0 ? -error : error, 0);
+		bench_puts("\n");
+	}
+	bench_puts("Done\n");
+
+	while (1)
+		wfi();
+}
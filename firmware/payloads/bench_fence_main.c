@@ -0,0 +1,118 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Remote fence round-trip benchmark. The boot hart starts every other
+ * hart (they park in wfi and only take the firmware's IPIs), then times
+ * remote fence.i and sfence.vma calls against 1, 2, 4, ... of them.
+ */
+
+#include "bench.h"
+
+#define BENCH_WARMUP	16
+#define BENCH_ITERS	1000
+/* Only hart mask base 0 is used */
+#define BENCH_MAX_HARTS	__riscv_xlen
+
+extern char _start[];
+
+static const struct {
+	const char *name;
+	unsigned long fid;
+	unsigned long start;
+	unsigned long size;
+} bench_ops[] = {
+	{ "    fence.i", SBI_EXT_RFENCE_REMOTE_FENCE_I, 0, 0 },
+	{ " sfence.vma", SBI_EXT_RFENCE_REMOTE_SFENCE_VMA, 0, -1UL },
+	{ "    4K page", SBI_EXT_RFENCE_REMOTE_SFENCE_VMA, 0x1000, 0x1000 },
+};
+
+#define BENCH_OPS (sizeof(bench_ops) / sizeof(bench_ops[0]))
+
+static long bench_hart_status(unsigned long hartid)
+{
+	struct sbiret ret = bench_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_GET_STATUS,
+					hartid, 0, 0, 0);
+
+	return ret.error ? ret.error : ret.value;
+}
+
+/* Start every stopped hart and return how many are up, in targets[] */
+static int bench_start_harts(unsigned long self, unsigned long *targets)
+{
+	unsigned long h;
+	long status;
+	struct sbiret ret;
+	int n = 0;
+
+	for (h = 0; h < BENCH_MAX_HARTS; h++) {
+		if (h == self)
+			continue;
+		status = bench_hart_status(h);
+		if (status == SBI_HSM_STATE_STOPPED) {
+			/* It loses the hart lottery and parks */
+			ret = bench_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_START,
+					  h, (unsigned long)_start, 0, 0);
+			if (ret.error)
+				continue;
+			do {
+				status = bench_hart_status(h);
+			} while (status == SBI_HSM_STATE_START_PENDING);
+		}
+		if (status == SBI_HSM_STATE_STARTED)
+			targets[n++] = h;
+	}
+
+	return n;
+}
+
+static unsigned long bench_run(int op, unsigned long hmask)
+{
+	unsigned long i, start = 0;
+
+	for (i = 0; i < BENCH_WARMUP + BENCH_ITERS; i++) {
+		if (i == BENCH_WARMUP)
+			start = bench_time();
+		bench_ecall(SBI_EXT_RFENCE, bench_ops[op].fid, hmask, 0,
+			    bench_ops[op].start, bench_ops[op].size);
+	}
+
+	return bench_time() - start;
+}
+
+static void bench_row(const unsigned long *targets, int n)
+{
+	unsigned long hmask = 0;
+	int i, op;
+
+	for (i = 0; i < n; i++)
+		hmask |= 1UL << targets[i];
+	bench_putdec(n, 7);
+	for (op = 0; op < BENCH_OPS; op++)
+		bench_putavg(bench_run(op, hmask), BENCH_ITERS, 11);
+	bench_puts("\n");
+}
+
+void test_main(unsigned long a0, unsigned long a1)
+{
+	unsigned long targets[BENCH_MAX_HARTS];
+	int op, n, ntargets;
+
+	bench_puts("\nRemote fence round trip, time ticks per call\n");
+	ntargets = bench_start_harts(a0, targets);
+	if (!ntargets)
+		bench_puts("No other hart to fence\n");
+
+	bench_puts("targets");
+	for (op = 0; op < BENCH_OPS; op++)
+		bench_puts(bench_ops[op].name);
+	bench_puts("\n");
+	for (n = 1; n <= ntargets; n *= 2) {
+		bench_row(targets, n);
+		if (n < ntargets && 2 * n > ntargets)
+			bench_row(targets, ntargets);
+	}
+	bench_puts("Done\n");
+
+	while (1)
+		wfi();
+}
@@ -17,3 +17,25 @@ test-y += test_main.o
 
 %/test.dep: $(foreach dep,$(test-y:.o=.dep),%/$(dep))
 	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/bench_fence.bin
+
+bench_fence-y += test_head.o
+bench_fence-y += bench_fence_main.o
+
+%/bench_fence.o: $(foreach obj,$(bench_fence-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/bench_fence.dep: $(foreach dep,$(bench_fence-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
+
+firmware-bins-$(FW_PAYLOAD) += payloads/bench_ecall.bin
+
+bench_ecall-y += test_head.o
+bench_ecall-y += bench_ecall_main.o
+
+%/bench_ecall.o: $(foreach obj,$(bench_ecall-y),%/$(obj))
+	$(call merge_objs,$@,$^)
+
+%/bench_ecall.dep: $(foreach dep,$(bench_ecall-y:.o=.dep),%/$(dep))
+	$(call merge_deps,$@,$^)
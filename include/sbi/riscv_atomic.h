@@ -67,4 +67,12 @@ int atomic_raw_set_bit(int nr, volatile unsigned long *addr);
  */
 int atomic_raw_clear_bit(int nr, volatile unsigned long *addr);
 
+/**
+ * Or a mask into any address and return the old value.
+ * @ptr: Address to modify
+ * @mask: Bits to set
+ */
+unsigned long atomic_raw_fetch_or_ulong(volatile unsigned long *ptr,
+					unsigned long mask);
+
 #endif
@@ -17,6 +17,11 @@
 #define SBI_ECALL_VERSION_MINOR		3
 #define SBI_OPENSBI_IMPID		1
 
+/** Most extensions that can be registered at once */
+#define SBI_ECALL_MAX_EXTENSIONS	32
+/** Entries in the extension lookup cache, a power of two */
+#define SBI_ECALL_CACHE_SIZE		16
+
 struct sbi_trap_regs;
 struct sbi_trap_info;
 
@@ -55,6 +60,8 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext);
 
 void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext);
 
+int sbi_ecall_fast_handler(const struct sbi_trap_regs *regs);
+
 int sbi_ecall_handler(struct sbi_trap_regs *regs);
 
 int sbi_ecall_init(void);
@@ -100,6 +100,8 @@
 #define SBI_EXT_PMU_COUNTER_STOP	0x4
 #define SBI_EXT_PMU_COUNTER_FW_READ	0x5
 
+#ifndef __ASSEMBLER__
+
 /** General pmu event codes specified in SBI PMU extension */
 enum sbi_pmu_hw_generic_events_t {
 	SBI_PMU_HW_NO_EVENT			= 0,
@@ -181,7 +183,17 @@ enum sbi_pmu_fw_event_code_id {
 	SBI_PMU_FW_HFENCE_VVMA_RCVD	= 19,
 	SBI_PMU_FW_HFENCE_VVMA_ASID_SENT = 20,
 	SBI_PMU_FW_HFENCE_VVMA_ASID_RCVD = 21,
+
 	SBI_PMU_FW_MAX,
+
+	/* Codes from 256 on are implementation specific */
+	SBI_PMU_FW_IMPL_BASE		= 256,
+	/* OpenSBI specific: remote fences queued vs merged into a queued one */
+	SBI_PMU_FW_FENCE_QUEUED		= SBI_PMU_FW_IMPL_BASE,
+	SBI_PMU_FW_FENCE_MERGED		= 257,
+	/* OpenSBI specific: doorbells skipped as the target had events pending */
+	SBI_PMU_FW_IPI_COALESCED	= 258,
+	SBI_PMU_FW_IMPL_MAX,
 };
 
 /** SBI PMU event idx type */
@@ -199,6 +211,8 @@ enum sbi_pmu_ctr_type {
 	SBI_PMU_CTR_TYPE_FW,
 };
 
+#endif
+
 /* Helper macros to decode event idx */
 #define SBI_PMU_EVENT_IDX_OFFSET 20
 #define SBI_PMU_EVENT_IDX_MASK 0xFFFFF
@@ -35,4 +35,28 @@ void __sbi_hfence_vvma_va(unsigned long va);
 /** Invalidate all possible Stage2 TLBs */
 void __sbi_hfence_vvma_all(void);
 
+/** Order prior stores before following Svinval invalidations */
+void __sbi_sfence_w_inval(void);
+
+/** Order prior Svinval invalidations before following implicit accesses */
+void __sbi_sfence_inval_ir(void);
+
+/** Svinval: invalidate TLB entries for given ASID and virtual address */
+void __sbi_sinval_vma_asid_va(unsigned long va, unsigned long asid);
+
+/** Svinval: invalidate TLB entries for given virtual address */
+void __sbi_sinval_vma_va(unsigned long va);
+
+/** Svinval: invalidate guest TLB entries for given ASID and virtual address */
+void __sbi_hinval_vvma_asid_va(unsigned long va, unsigned long asid);
+
+/** Svinval: invalidate guest TLB entries for given virtual address */
+void __sbi_hinval_vvma_va(unsigned long va);
+
+/** Svinval: invalidate Stage2 TLBs for given VMID and guest physical address */
+void __sbi_hinval_gvma_vmid_gpa(unsigned long gpa, unsigned long vmid);
+
+/** Svinval: invalidate Stage2 TLBs for given guest physical address */
+void __sbi_hinval_gvma_gpa(unsigned long gpa);
+
 #endif
@@ -16,6 +16,9 @@
 
 #define SBI_IPI_EVENT_MAX			__riscv_xlen
 
+/** Fewest targets for which tree fan-out beats ringing each one */
+#define SBI_IPI_TREE_MIN_TARGETS		8
+
 /* clang-format on */
 
 /** IPI hardware device */
@@ -65,6 +68,12 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data);
 
 int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops);
 
+void sbi_ipi_tree_set_group(u32 hartid, u32 group);
+
+void sbi_ipi_tree_enable(bool enable);
+
+void sbi_ipi_forward(void);
+
 void sbi_ipi_event_destroy(u32 event);
 
 int sbi_ipi_send_smode(ulong hmask, ulong hbase);
@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Lock-free bounded multi-producer single-consumer ring with the same
+ * interface as sbi_fifo.
+ */
+
+#ifndef __SBI_MPSC_H__
+#define __SBI_MPSC_H__
+
+#include <sbi/riscv_atomic.h>
+#include <sbi/sbi_fifo.h>
+#include <sbi/sbi_types.h>
+
+struct sbi_mpsc {
+	void *queue;
+	/* Next position the consumer takes, only it writes this */
+	atomic_t head;
+	/* Next position a producer claims */
+	atomic_t tail;
+	u16 entry_size;
+	u16 num_entries;
+	u16 slot_size;
+};
+
+/* Each slot is a sequence word followed by the entry */
+#define SBI_MPSC_SLOT_SIZE(__entry_size)                                 \
+	(sizeof(atomic_t) + (((__entry_size) + sizeof(long) - 1) &      \
+			     ~(sizeof(long) - 1)))
+#define SBI_MPSC_MEM_SIZE(__entries, __entry_size)                       \
+	((__entries) * SBI_MPSC_SLOT_SIZE(__entry_size))
+
+int sbi_mpsc_dequeue(struct sbi_mpsc *q, void *data);
+int sbi_mpsc_enqueue(struct sbi_mpsc *q, void *data);
+void sbi_mpsc_init(struct sbi_mpsc *q, void *queue_mem, u16 entries,
+		   u16 entry_size);
+int sbi_mpsc_is_empty(struct sbi_mpsc *q);
+int sbi_mpsc_is_full(struct sbi_mpsc *q);
+int sbi_mpsc_inplace_update(struct sbi_mpsc *q, void *in,
+			    int (*fptr)(void *in, void *data));
+u16 sbi_mpsc_avail(struct sbi_mpsc *q);
+
+#endif
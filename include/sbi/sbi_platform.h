@@ -37,6 +37,8 @@
 #define SBI_PLATFORM_HART_INDEX2ID_OFFSET (0x58 + (__SIZEOF_POINTER__ * 2))
 
 #define SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT		(1UL << 12)
+/** Let sbi_tlb measure the range flush limit on the boot hart */
+#define SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_CALIBRATE	(~0ULL)
 
 #ifndef __ASSEMBLER__
 
@@ -244,7 +246,8 @@ static inline unsigned long sbi_platform_get_features(
  * @param plat pointer to struct sbi_platform
  *
  * @return tlb range flush limit value. Returns a default (page size) if not
- * defined by platform.
+ * defined by platform, or SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_CALIBRATE if
+ * the platform wants it measured at boot.
  */
 static inline u64 sbi_platform_tlbr_flush_limit(const struct sbi_platform *plat)
 {
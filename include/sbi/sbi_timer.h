@@ -66,6 +66,18 @@ void sbi_timer_set_delta_upper(ulong delta_upper);
 /** Start timer event for current HART */
 void sbi_timer_event_start(u64 next_event);
 
+/** Start firmware (M-mode) timer event for current HART */
+void sbi_timer_fw_event_start(u64 next_event);
+
+/** Stop firmware (M-mode) timer event for current HART */
+void sbi_timer_fw_event_stop(void);
+
+/** Number of S-mode timer events started on current HART */
+unsigned long sbi_timer_smode_starts(void);
+
+/** Set the handler called when a firmware timer event expires */
+void sbi_timer_set_fw_handler(void (*fn)(void));
+
 /** Process timer event for current HART */
 void sbi_timer_process(void);
 
@@ -55,6 +55,8 @@ do { \
 
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo);
 
+unsigned long sbi_tlb_range_flush_limit(void);
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot);
 
 #endif
@@ -4,6 +4,9 @@
 #define SATP_ACCESS 0x18000073
 #define SFENCE_VM_MASK 0xfe007fff
 #define SATP_ACCESS_MASK 0xfff0007f
+/* TVM event scope covering every address or every ASID */
+#define RVBT_SCOPE_ALL (-1UL)
+#define RVBT_MAX_BREAKPOINTS 16
 
 #include <sbi_utils/rvbt/rvbt_memory.h>
 #include <sbi/riscv_asm.h>
@@ -11,22 +14,78 @@
 enum rvbt_bp_type_t {
 	INST,
 	DATA,
+	WATCH,
 };
 
-struct rvbt_addr_pair_t{
-  uint64_t virt_addr;
-  uint64_t phys_addr;
-	struct mem_reg_t *mem_reg;
+/* Bits of rvbt_breakpoint_t.notified */
+#define RVBT_NOTIFIED_DEFERRED 0
+#define RVBT_NOTIFIED_ARMED 1
+
+/* Accesses a watchpoint reports */
+#define RVBT_WATCH_READ 0x1
+#define RVBT_WATCH_WRITE 0x2
+
+/* Address space (satp) or hart a breakpoint is armed in */
+enum rvbt_bp_filter_t {
+	FILTER_NONE,
+	FILTER_ASID,
+	FILTER_ROOT,
+	FILTER_HART,
 };
 
 struct rvbt_breakpoint_t {
 	uint64_t log2size;
-  struct rvbt_addr_pair_t addr[16];
+	uint64_t size;
+	uint8_t access;
+	/* Translated per hart, see struct rvbt_hart_t */
+	uint64_t virt_addr;
 	enum rvbt_bp_type_t type;
+	enum rvbt_bp_filter_t filter;
+	uint64_t space;
   bool enabled;
+	/* RVBT_NOTIFIED_* already reported for this breakpoint, any hart */
+	unsigned long notified;
+};
+
+/* One PMP entry handed out by the breakpoint slot allocator */
+struct rvbt_slot_t {
+	enum rvbt_bp_type_t type;
+	uint64_t base;
+	uint64_t end;
+	uint64_t phys_addr;
+	uint64_t log2size;
+	unsigned long prot;
+	int users;
+};
+
+struct rvbt_bp_stats_t {
+	int slots;
+	uint64_t unarmed;
+	uint64_t hits;
+	uint64_t false_hits;
+	uint64_t watch_hits;
+	uint64_t watch_filtered;
 };
 
+struct rvbt_hart_t;
+
+extern struct rvbt_breakpoint_t rvbt_breakpoints[RVBT_MAX_BREAKPOINTS];
+
 int rvbt_update_breakpoint();
+void rvbt_sync_breakpoint();
+void rvbt_breakpoint_changed(struct rvbt_breakpoint_t *bp);
+unsigned long rvbt_breakpoint_gen();
+bool rvbt_breakpoint_false_hit(uint64_t virt_addr);
+void rvbt_set_cluster_window(uint64_t log2size);
+void rvbt_breakpoint_info();
+struct rvbt_bp_stats_t *rvbt_breakpoint_stats();
 int rvbt_set_inst_point(uint64_t virt_addr);
+int rvbt_set_inst_point_in(uint64_t virt_addr, enum rvbt_bp_filter_t filter,
+			   uint64_t space);
+void rvbt_resolve_pending(uint64_t virt_addr, uint64_t asid);
 int rvbt_set_data_point(uint64_t virt_addr, uint64_t log2size);
+int rvbt_set_watch_point(uint64_t virt_addr, uint64_t size, uint8_t access);
+void rvbt_clear_point(int idx);
+bool rvbt_watch_range(int idx, struct rvbt_hart_t *hart, uint64_t *base,
+		      uint64_t *end);
 #endif
@@ -0,0 +1,72 @@
+#ifndef __RVBT_COREDUMP_H__
+#define __RVBT_COREDUMP_H__
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+#define RVBT_EM_RISCV	  243
+#define RVBT_ET_CORE	  4
+#define RVBT_PT_LOAD	  1
+#define RVBT_PT_NOTE	  4
+#define RVBT_NT_PRSTATUS  1
+
+struct rvbt_elf64_ehdr_t {
+	uint8_t e_ident[16];
+	uint16_t e_type;
+	uint16_t e_machine;
+	uint32_t e_version;
+	uint64_t e_entry;
+	uint64_t e_phoff;
+	uint64_t e_shoff;
+	uint32_t e_flags;
+	uint16_t e_ehsize;
+	uint16_t e_phentsize;
+	uint16_t e_phnum;
+	uint16_t e_shentsize;
+	uint16_t e_shnum;
+	uint16_t e_shstrndx;
+};
+
+struct rvbt_elf64_phdr_t {
+	uint32_t p_type;
+	uint32_t p_flags;
+	uint64_t p_offset;
+	uint64_t p_vaddr;
+	uint64_t p_paddr;
+	uint64_t p_filesz;
+	uint64_t p_memsz;
+	uint64_t p_align;
+};
+
+struct rvbt_elf64_nhdr_t {
+	uint32_t n_namesz;
+	uint32_t n_descsz;
+	uint32_t n_type;
+	/* "CORE" padded to 4 bytes */
+	char n_name[8];
+};
+
+/*
+ * struct elf_prstatus of a riscv64 Linux core. pr_reg is user_regs_struct,
+ * which is x0..x31 with pc in place of x0.
+ */
+struct rvbt_prstatus_t {
+	int32_t si_signo;
+	int32_t si_code;
+	int32_t si_errno;
+	int16_t pr_cursig;
+	uint16_t __pad0;
+	uint64_t pr_sigpend;
+	uint64_t pr_sighold;
+	int32_t pr_pid;
+	int32_t pr_ppid;
+	int32_t pr_pgrp;
+	int32_t pr_sid;
+	uint64_t pr_times[8];
+	uint64_t pr_reg[32];
+	int32_t pr_fpvalid;
+	uint32_t __pad1;
+};
+
+int rvbt_coredump(struct sbi_trap_regs *regs, uint64_t region_mask);
+void rvbt_coredump_regions(void);
+#endif
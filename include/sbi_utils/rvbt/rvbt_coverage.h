@@ -0,0 +1,29 @@
+#ifndef __RVBT_COVERAGE_H__
+#define __RVBT_COVERAGE_H__
+#include "sbi/sbi_bitops.h"
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+#define RVBT_COV_BLOCKS 1024
+#define RVBT_COV_MAGIC	"RVCOV1"
+
+/* A basic block start patched with an ebreak until it first runs */
+struct rvbt_cov_block_t {
+	uint64_t virt_addr;
+	uint64_t phys_addr;
+	uint16_t orig[2];
+	uint8_t len;
+	bool armed;
+};
+
+struct rvbt_hart_t;
+
+int rvbt_cov_add(uint64_t virt_addr);
+int rvbt_cov_load(void);
+int rvbt_cov_start(void);
+void rvbt_cov_stop(void);
+void rvbt_cov_sync(struct rvbt_hart_t *hart);
+bool rvbt_cov_hit(struct sbi_trap_regs *regs);
+void rvbt_cov_info(void);
+void rvbt_cov_dump(void);
+#endif
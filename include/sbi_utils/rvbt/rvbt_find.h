@@ -0,0 +1,28 @@
+#ifndef __RVBT_FIND_H__
+#define __RVBT_FIND_H__
+#include "sbi/riscv_atomic.h"
+#include "sbi/sbi_types.h"
+
+#define RVBT_FIND_MAX	64
+/* Unit of work handed to parked harts */
+#define RVBT_FIND_CHUNK (1UL << 20)
+
+/* value and mask are replicated over every lane of a 64-bit word */
+struct rvbt_find_t {
+	uint64_t value;
+	uint64_t mask;
+	/* Top bit of every lane */
+	uint64_t top;
+	unsigned long width;
+	/* Our own image, which holds the pattern in .bss and on the stacks */
+	uint64_t skip_base;
+	uint64_t skip_end;
+	atomic_t hits;
+	uint64_t phys[RVBT_FIND_MAX];
+	uint64_t virt[RVBT_FIND_MAX];
+};
+
+int rvbt_find_phys(uint64_t value, uint64_t mask, unsigned long width);
+int rvbt_find_virt(uint64_t virt_addr, uint64_t len, uint64_t value,
+		   uint64_t mask, unsigned long width);
+#endif
@@ -0,0 +1,39 @@
+#ifndef __RVBT_FTRACE_H__
+#define __RVBT_FTRACE_H__
+#include "sbi/riscv_atomic.h"
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+#define RVBT_FTRACE_FUNCS 4
+/* Nested traced calls remembered per hart */
+#define RVBT_FTRACE_DEPTH 8
+/* Bucket n counts latencies in [2^n, 2^(n+1)) mtime ticks */
+#define RVBT_FTRACE_BUCKETS 32
+
+struct rvbt_ftrace_fn_t {
+	uint64_t entry;
+	int bp;
+	atomic_t calls;
+	atomic_t dropped;
+	atomic_t hist[RVBT_FTRACE_BUCKETS];
+};
+
+/* A traced call that has not returned yet */
+struct rvbt_ftrace_frame_t {
+	uint64_t ret;
+	uint64_t sp;
+	uint64_t start;
+	int fn;
+	int bp;
+};
+
+struct rvbt_ftrace_stack_t {
+	int depth;
+	struct rvbt_ftrace_frame_t frames[RVBT_FTRACE_DEPTH];
+};
+
+int rvbt_ftrace_init(void);
+int rvbt_ftrace_add(uint64_t entry);
+bool rvbt_ftrace_hit(struct sbi_trap_regs *regs);
+void rvbt_ftrace_show(void);
+#endif
@@ -0,0 +1,51 @@
+#ifndef __RVBT_HART_H__
+#define __RVBT_HART_H__
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_timer.h"
+
+/*
+ * Raven state private to one hart, kept in its scratch space. The
+ * translations are split into parallel arrays so the arming and false-hit
+ * loops only walk this hart's lines instead of a per-hart slice of every
+ * breakpoint.
+ */
+struct rvbt_hart_t {
+	bool stepping;
+	bool continuing;
+	/* rvbt_breakpoint_gen() this hart's PMP entries were armed at */
+	unsigned long gen;
+	/* Coverage patch generation this hart has fenced and delegated for */
+	unsigned long cov_gen;
+	struct sbi_trap_regs *volatile parked_regs;
+	/* Firmware timer deadline per client, see rvbt_timer.c */
+	uint64_t timer_next[RVBT_TIMER_CLIENTS];
+	/* Watchdog view of this hart at its previous check */
+	unsigned long wdog_gen;
+	unsigned long wdog_events;
+	int wdog_stuck;
+	bool wdog_fired;
+	struct rvbt_bp_stats_t stats;
+	/* Breakpoints whose VA is not mapped in this hart's current space */
+	unsigned long pending;
+	/* Breakpoints holding a PMP entry on this hart */
+	unsigned long armed;
+	uint64_t phys_addr[RVBT_MAX_BREAKPOINTS];
+	struct mem_reg_t *mem_reg[RVBT_MAX_BREAKPOINTS];
+};
+
+static inline bool rvbt_bp_pending(struct rvbt_hart_t *hart, int idx)
+{
+	return hart->pending & (1UL << idx);
+}
+
+static inline bool rvbt_bp_armed(struct rvbt_hart_t *hart, int idx)
+{
+	return hart->armed & (1UL << idx);
+}
+
+int rvbt_hart_init(void);
+struct rvbt_hart_t *rvbt_hart(void);
+struct rvbt_hart_t *rvbt_hart_of(u32 hartid);
+#endif
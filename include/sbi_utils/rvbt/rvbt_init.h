@@ -2,7 +2,10 @@
 #define __RVBT_INIT_H__
 #include "sbi/sbi_trap.h"
 
-void rvbt_init(const void* fdt);
+void rvbt_init(void* fdt);
 int rvbt_loop(struct sbi_trap_regs* regs);
+int rvbt_prompt(struct sbi_trap_regs* regs);
+void rvbt_resume(struct sbi_trap_regs* regs);
+void rvbt_dump_regs(const struct sbi_trap_regs *regs);
 
 #endif
@@ -7,6 +7,9 @@
 #include <sbi/riscv_encoding.h>
 #include <libfdt.h>
 
+/* PMP entries reserved for Raven, ahead of the domain regions */
+#define RVBT_PMP_SLOTS 4
+
 struct mem_reg_t {
 	uint64_t base;
   uint64_t size;
@@ -44,6 +47,13 @@ struct mem_reg_t* rvbt_in_phys_mem(void *addr);
 uint64_t rvbt_pageroot_translate(uint64_t virt_addr, uint64_t root_ppn);
 uint64_t rvbt_mmu_translate(uint64_t virt_addr, uint64_t satp);
 void rvbt_clear_pmp();
+void rvbt_clear_pmp_slot(int n);
+void rvbt_pmp_set_tor(int n, unsigned long prot, uint64_t base, uint64_t end);
+int rvbt_unwind(uint64_t fp, uint64_t satp, uint64_t *ret, int max);
+void rvbt_reverse_map(uint64_t satp_val, const uint64_t *phys, uint64_t *virt,
+		      int n);
+void rvbt_reverse_map_kernel(uint64_t satp_val, const uint64_t *phys,
+			     uint64_t *virt, int n);
 
 extern struct mem_reg_t mem_regs[64];
 extern uint8_t mem_reg_cnt;
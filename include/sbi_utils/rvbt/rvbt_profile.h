@@ -0,0 +1,32 @@
+#ifndef __RVBT_PROFILE_H__
+#define __RVBT_PROFILE_H__
+#include "sbi/sbi_types.h"
+
+/* Distinct PCs (including frame-pointer callers) kept per hart */
+#define RVBT_PROF_BUCKETS 64
+#define RVBT_PROF_PROBES  8
+#define RVBT_PROF_MAX_DEPTH 4
+#define RVBT_PROF_MAX_HZ  10000
+
+struct rvbt_prof_entry_t {
+	uint64_t pc;
+	uint32_t self;
+	uint32_t total;
+};
+
+struct rvbt_prof_t {
+	unsigned long gen;
+	uint64_t samples;
+	uint64_t dropped;
+	uint64_t skipped;
+	struct rvbt_prof_entry_t tab[RVBT_PROF_BUCKETS];
+};
+
+struct rvbt_hart_t;
+
+int rvbt_prof_init(void);
+int rvbt_prof_start(unsigned long hz, int depth);
+void rvbt_prof_stop(void);
+void rvbt_prof_sync(struct rvbt_hart_t *hart);
+void rvbt_prof_top(int n);
+#endif
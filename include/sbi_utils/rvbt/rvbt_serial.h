@@ -7,4 +7,6 @@ int rvbt_serial_init();
 int rvbt_printf(const char* fmt, ...);
 
 char* rvbt_gets();
+
+void rvbt_write_raw(const void *buf, unsigned long len);
 #endif
@@ -0,0 +1,26 @@
+#ifndef __RVBT_SMP_H__
+#define __RVBT_SMP_H__
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+enum rvbt_smp_mode_t { ALL_STOP, NON_STOP };
+
+struct rvbt_smp_stats_t {
+	int stops;
+	int parked;
+	int missed;
+	u64 last_ticks;
+	u64 max_ticks;
+};
+
+int rvbt_smp_init(void);
+void rvbt_smp_set_mode(enum rvbt_smp_mode_t mode);
+void rvbt_smp_stop(struct sbi_trap_regs *regs);
+void rvbt_smp_release(void);
+bool rvbt_smp_world_stopped(void);
+void rvbt_smp_parallel(void (*fn)(void *arg, unsigned long chunk), void *arg,
+		       unsigned long chunks);
+void rvbt_smp_info(void);
+struct sbi_trap_regs *rvbt_trap_regs(struct sbi_scratch *scratch);
+#endif
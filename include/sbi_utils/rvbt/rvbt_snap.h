@@ -0,0 +1,30 @@
+#ifndef __RVBT_SNAP_H__
+#define __RVBT_SNAP_H__
+#include "sbi/sbi_bitops.h"
+#include "sbi/sbi_types.h"
+
+/* 64KB of hashes; bigger selections get bigger blocks */
+#define RVBT_SNAP_BLOCKS    16384
+#define RVBT_SNAP_BLOCK_MIN 4096
+#define RVBT_SNAP_RANGES    8
+/* Changed 4K blocks whose contents a diff keeps for word-level diffs */
+#define RVBT_SNAP_KEEP	    8
+/* Blocks per unit of work handed to parked harts */
+#define RVBT_SNAP_CHUNK	    256
+
+struct rvbt_snap_range_t {
+	uint64_t base;
+	uint64_t size;
+	/* Index of the range's first block in the hash arena */
+	unsigned long first;
+};
+
+struct rvbt_snap_keep_t {
+	uint64_t base;
+	uint64_t data[RVBT_SNAP_BLOCK_MIN / 8];
+};
+
+int rvbt_snap(uint64_t base, uint64_t size);
+void rvbt_snap_diff(void);
+int rvbt_snap_words(uint64_t addr);
+#endif
@@ -104,7 +104,6 @@ struct cr_insn_t {
 }__attribute__((packed));
 
 
-extern bool is_stepping[16];
 int rvbt_stepping(struct sbi_trap_regs* regs);
 uint64_t rvbt_jump_decode(uint32_t insn,uint64_t insn_addr, struct sbi_trap_regs *regs, bool modifying);
 uint64_t rvbt_jump_predict(uint32_t insn,uint64_t insn_addr, struct sbi_trap_regs *regs, bool modifying);
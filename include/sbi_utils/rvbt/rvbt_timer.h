@@ -0,0 +1,19 @@
+#ifndef __RVBT_TIMER_H__
+#define __RVBT_TIMER_H__
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_types.h"
+
+/* Raven users of the firmware M-timer event, each with its own deadline */
+enum rvbt_timer_client_t {
+	RVBT_TIMER_PROF,
+	RVBT_TIMER_WDOG,
+	RVBT_TIMER_CLIENTS,
+};
+
+typedef void (*rvbt_timer_fn_t)(struct sbi_scratch *scratch);
+
+void rvbt_timer_init(void);
+void rvbt_timer_register(enum rvbt_timer_client_t client, rvbt_timer_fn_t fn);
+void rvbt_timer_start(enum rvbt_timer_client_t client, uint64_t next);
+void rvbt_timer_stop(enum rvbt_timer_client_t client);
+#endif
@@ -0,0 +1,35 @@
+#ifndef __RVBT_TRACE_H__
+#define __RVBT_TRACE_H__
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+/* Bytes of delta-encoded branch records kept per hart */
+#define RVBT_TRACE_RING_SIZE 512
+
+/*
+ * Last-branch ring. Each record is three zigzag varints: from relative to
+ * the previous record's target, to relative to from, and the mtime delta.
+ * base_* hold the values preceding the oldest record so the ring can be
+ * decoded after old records are overwritten.
+ */
+struct rvbt_trace_t {
+	uint64_t left;
+	uint64_t steps;
+	uint64_t branches;
+	uint64_t start;
+	uint64_t base_to;
+	uint64_t base_time;
+	uint64_t last_to;
+	uint64_t last_time;
+	uint32_t head;
+	uint32_t used;
+	uint32_t records;
+	uint8_t ring[RVBT_TRACE_RING_SIZE];
+};
+
+int rvbt_trace_init(void);
+bool rvbt_trace_active(void);
+int rvbt_trace_start(struct sbi_trap_regs *regs, uint64_t window);
+int rvbt_trace_step(struct sbi_trap_regs *regs);
+void rvbt_trace_dump(void);
+#endif
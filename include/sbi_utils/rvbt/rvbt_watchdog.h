@@ -0,0 +1,16 @@
+#ifndef __RVBT_WATCHDOG_H__
+#define __RVBT_WATCHDOG_H__
+#include "sbi/sbi_types.h"
+
+/* Checks per timeout, a hart must fail all of them in a row */
+#define RVBT_WDOG_CHECKS 4
+#define RVBT_WDOG_DEPTH	 16
+
+struct rvbt_hart_t;
+
+void rvbt_wdog_init(void);
+int rvbt_wdog_start(unsigned long timeout_ms, bool prompt);
+void rvbt_wdog_stop(void);
+void rvbt_wdog_sync(struct rvbt_hart_t *hart);
+void rvbt_wdog_info(void);
+#endif
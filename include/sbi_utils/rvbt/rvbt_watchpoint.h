@@ -0,0 +1,7 @@
+#ifndef __RVBT_WATCHPOINT_H__
+#define __RVBT_WATCHPOINT_H__
+#include "sbi/sbi_trap.h"
+#include "sbi/sbi_types.h"
+
+bool rvbt_watch_access(ulong mcause, ulong mtval, struct sbi_trap_regs *regs);
+#endif
@@ -242,6 +242,18 @@ inline int atomic_raw_clear_bit(int nr, volatile unsigned long *addr)
 	return __atomic_op_bit(and, __NOT, nr, addr);
 }
 
+unsigned long atomic_raw_fetch_or_ulong(volatile unsigned long *ptr,
+					unsigned long mask)
+{
+	unsigned long res;
+
+	__asm__ __volatile__(__AMO(or) ".aqrl %0, %2, %1"
+			     : "=r"(res), "+A"(*ptr)
+			     : "r"(mask)
+			     : "memory");
+	return res;
+}
+
 inline int atomic_set_bit(int nr, atomic_t *atom)
 {
 	return atomic_raw_set_bit(nr, (unsigned long *)&atom->counter);
@@ -11,6 +11,8 @@
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 
 u16 sbi_ecall_version_major(void)
@@ -37,18 +39,71 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
-struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+/*
+ * Dispatch goes through a direct-mapped cache of recently used extensions
+ * and falls back to a binary search over the registered ranges sorted by
+ * extid_start. Both are rebuilt from ecall_exts_list on every register
+ * and unregister, which only happen at boot.
+ */
+static struct sbi_ecall_extension *ecall_exts_sorted[SBI_ECALL_MAX_EXTENSIONS];
+static u32 ecall_exts_count;
+static struct sbi_ecall_extension *ecall_exts_cache[SBI_ECALL_CACHE_SIZE];
+
+/* Mix the vendor/legacy high bytes in so EIDs like "TIME" and 0x0 differ */
+static inline u32 ecall_cache_index(unsigned long extid)
+{
+	u32 h = extid ^ (extid >> 8) ^ (extid >> 16) ^ (extid >> 24);
+
+	return h & (SBI_ECALL_CACHE_SIZE - 1);
+}
+
+static void ecall_exts_rebuild(void)
 {
-	struct sbi_ecall_extension *t, *ret = NULL;
+	u32 i, n = 0;
+	struct sbi_ecall_extension *t;
 
 	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
-		if (t->extid_start <= extid && extid <= t->extid_end) {
-			ret = t;
-			break;
+		for (i = n; i > 0; i--) {
+			if (ecall_exts_sorted[i - 1]->extid_start < t->extid_start)
+				break;
+			ecall_exts_sorted[i] = ecall_exts_sorted[i - 1];
 		}
+		ecall_exts_sorted[i] = t;
+		n++;
+	}
+	ecall_exts_count = n;
+
+	for (i = 0; i < SBI_ECALL_CACHE_SIZE; i++)
+		ecall_exts_cache[i] = NULL;
+}
+
+struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+{
+	u32 lo = 0, hi = ecall_exts_count, mid;
+	u32 idx = ecall_cache_index(extid);
+	struct sbi_ecall_extension *t = ecall_exts_cache[idx];
+
+	/* The range check makes a colliding or stale entry a plain miss */
+	if (t && t->extid_start <= extid && extid <= t->extid_end)
+		return t;
+
+	/* Last range starting at or below extid */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (ecall_exts_sorted[mid]->extid_start <= extid)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	if (!lo)
+		return NULL;
+
+	t = ecall_exts_sorted[lo - 1];
+	if (extid > t->extid_end)
+		return NULL;
 
-	return ret;
+	ecall_exts_cache[idx] = t;
+	return t;
 }
 
 int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
@@ -58,6 +113,9 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 	if (!ext || (ext->extid_end < ext->extid_start) || !ext->handle)
 		return SBI_EINVAL;
 
+	if (ecall_exts_count >= SBI_ECALL_MAX_EXTENSIONS)
+		return SBI_ENOSPC;
+
 	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
 		unsigned long start = t->extid_start;
 		unsigned long end = t->extid_end;
@@ -69,6 +127,7 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 
 	SBI_INIT_LIST_HEAD(&ext->head);
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
+	ecall_exts_rebuild();
 
 	return 0;
 }
@@ -88,8 +147,28 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		ecall_exts_rebuild();
+	}
+}
+
+/*
+ * S-mode TIME set_timer and IPI send_ipi straight from the trap entry in
+ * fw_base.S. Only the caller-saved registers in regs are valid, and the
+ * entry code does the return value and mepc update itself.
+ */
+int sbi_ecall_fast_handler(const struct sbi_trap_regs *regs)
+{
+	if (regs->a7 == SBI_EXT_IPI)
+		return sbi_ipi_send_smode(regs->a0, regs->a1);
+
+#if __riscv_xlen == 32
+	sbi_timer_event_start((((u64)regs->a1 << 32) | (u64)regs->a0));
+#else
+	sbi_timer_event_start((u64)regs->a0);
+#endif
+	return SBI_SUCCESS;
 }
 
 int sbi_ecall_handler(struct sbi_trap_regs *regs)
@@ -145,7 +224,6 @@ int sbi_ecall_init(void)
 {
 	int ret;
 
-	/* The order of below registrations is performance optimized */
 	ret = sbi_ecall_register_extension(&ecall_time);
 	if (ret)
 		return ret;
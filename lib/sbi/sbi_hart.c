@@ -297,6 +297,9 @@ static inline char *sbi_hart_feature_id2string(unsigned long feature)
 	case SBI_HART_HAS_TIME:
 		fstr = "time";
 		break;
+	case SBI_HART_HAS_SVINVAL:
+		fstr = "svinval";
+		break;
 	default:
 		break;
 	}
@@ -393,6 +396,28 @@ static int hart_pmu_get_allowed_bits(void)
 	return num_bits;
 }
 
+/* Svinval has no CSR to probe, so try SFENCE.W.INVAL under a trap guard */
+static bool hart_svinval_allowed(void)
+{
+	struct sbi_trap_info trap;
+	register ulong tinfo asm("a3") = (ulong)&trap;
+	register ulong ttmp asm("a4");
+	register ulong mtvec = sbi_hart_expected_trap_addr();
+
+	trap.cause = 0;
+	asm volatile(
+		"add %[ttmp], %[tinfo], zero\n"
+		"csrrw %[mtvec], " STR(CSR_MTVEC) ", %[mtvec]\n"
+		".word 0x18000073\n"
+		"csrw " STR(CSR_MTVEC) ", %[mtvec]"
+	    : [mtvec] "+&r"(mtvec), [tinfo] "+&r"(tinfo),
+	      [ttmp] "+&r"(ttmp)
+	    :
+	    : "memory");
+
+	return !trap.cause;
+}
+
 static void hart_detect_features(struct sbi_scratch *scratch)
 {
 	struct sbi_trap_info trap = {0};
@@ -507,6 +532,10 @@ __mhpm_skip:
 	csr_read_allowed(CSR_TIME, (unsigned long)&trap);
 	if (!trap.cause)
 		hfeatures->features |= SBI_HART_HAS_TIME;
+
+	/* Detect if hart supports Svinval */
+	if (hart_svinval_allowed())
+		hfeatures->features |= SBI_HART_HAS_SVINVAL;
 }
 
 int sbi_hart_reinit(struct sbi_scratch *scratch)
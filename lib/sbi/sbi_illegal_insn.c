@@ -172,6 +172,11 @@ int sbi_illegal_insn_handler(ulong insn, struct sbi_trap_regs *regs)
 		tvm_count++;
 		__asm__ __volatile("sfence.vma");
 		regs->mepc += 4;
+		rvbt_resolve_pending(
+			((insn >> SH_RS1) & 0x1f) ? GET_RS1(insn, regs) :
+						    RVBT_SCOPE_ALL,
+			((insn >> SH_RS2) & 0x1f) ? GET_RS2(insn, regs) :
+						    RVBT_SCOPE_ALL);
 		rvbt_update_breakpoint();
     //if (tvm_count % 1000 == 0)
       //sbi_printf("tvm_count: %d\n", tvm_count);
@@ -180,6 +185,7 @@ int sbi_illegal_insn_handler(ulong insn, struct sbi_trap_regs *regs)
 		tvm_count++;
 		rvbt_emulate_satp_access(insn, regs);
 		regs->mepc += 4;
+		rvbt_resolve_pending(RVBT_SCOPE_ALL, RVBT_SCOPE_ALL);
 		rvbt_update_breakpoint();
 		//if (tvm_count % 1000 == 0)
       //sbi_printf("tvm_count: %d\n", tvm_count);
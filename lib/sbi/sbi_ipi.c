@@ -25,11 +25,16 @@
 
 struct sbi_ipi_data {
 	unsigned long ipi_type;
+	/* Tree fan-out group, harts of a group share a leader */
+	u32 tree_group;
+	/* Harts this hart has to ring on behalf of an initiator */
+	struct sbi_hartmask tree_fwd;
 };
 
 static unsigned long ipi_data_off;
 static const struct sbi_ipi_device *ipi_dev = NULL;
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
+static bool ipi_tree;
 
 static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 			u32 event, void *data)
@@ -59,15 +64,19 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 
 	/*
 	 * Set IPI type on remote hart's scratch area and
-	 * trigger the interrupt
+	 * trigger the interrupt. Whoever set the first pending
+	 * bit rings, the remote hart picks up ours along with it.
 	 */
-	atomic_raw_set_bit(event, &ipi_data->ipi_type);
-	smp_wmb();
+	if (atomic_raw_fetch_or_ulong(&ipi_data->ipi_type, 1UL << event)) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_COALESCED);
+	} else {
+		smp_wmb();
 
-	if (ipi_dev && ipi_dev->ipi_send)
-		ipi_dev->ipi_send(remote_hartid);
+		if (ipi_dev && ipi_dev->ipi_send)
+			ipi_dev->ipi_send(remote_hartid);
 
-	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+	}
 
 	if (ipi_ops->sync)
 		ipi_ops->sync(scratch);
@@ -75,36 +84,121 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 	return 0;
 }
 
-/**
- * As this this function only handlers scalar values of hart mask, it must be
- * set to all online harts if the intention is to send IPIs to all the harts.
- * If hmask is zero, no IPIs will be sent.
+/*
+ * Tree fan-out: the initiator does every update and sets every event bit,
+ * but only rings the first target of each group. That leader rings the
+ * rest of its group from sbi_ipi_process(), so the initiator's MMIO writes
+ * scale with the number of groups rather than the number of targets.
+ * Events with a sync callback wait per target and always go flat.
  */
-int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
+static int sbi_ipi_send_tree(struct sbi_scratch *scratch,
+			     struct sbi_hartmask *targets, u32 event,
+			     void *data)
+{
+	u32 h, g;
+	u32 leader[SBI_HARTMASK_MAX_BITS];
+	struct sbi_hartmask leaders;
+	struct sbi_scratch *remote_scratch;
+	struct sbi_ipi_data *ipi_data;
+	const struct sbi_ipi_event_ops *ipi_ops = ipi_ops_array[event];
+
+	sbi_hartmask_for_each_hart(h, targets) {
+		remote_scratch = sbi_hartid_to_scratch(h);
+		if (!remote_scratch ||
+		    (ipi_ops->update &&
+		     ipi_ops->update(scratch, remote_scratch, h, data) < 0)) {
+			sbi_hartmask_clear_hart(h, targets);
+			continue;
+		}
+		ipi_data = sbi_scratch_offset_ptr(remote_scratch, ipi_data_off);
+		/* Already has a doorbell coming, leave it out of the tree */
+		if (atomic_raw_fetch_or_ulong(&ipi_data->ipi_type,
+					      1UL << event)) {
+			sbi_hartmask_clear_hart(h, targets);
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_COALESCED);
+		}
+	}
+
+	SBI_HARTMASK_INIT(&leaders);
+	sbi_memset(leader, 0xff, sizeof(leader));
+	sbi_hartmask_for_each_hart(h, targets) {
+		ipi_data = sbi_scratch_offset_ptr(sbi_hartid_to_scratch(h),
+						  ipi_data_off);
+		g = ipi_data->tree_group % SBI_HARTMASK_MAX_BITS;
+		if (leader[g] == -1U) {
+			leader[g] = h;
+			sbi_hartmask_set_hart(h, &leaders);
+			continue;
+		}
+		ipi_data = sbi_scratch_offset_ptr(sbi_hartid_to_scratch(leader[g]),
+						  ipi_data_off);
+		atomic_raw_set_bit(h, ipi_data->tree_fwd.bits);
+	}
+	smp_wmb();
+
+	sbi_hartmask_for_each_hart(h, &leaders) {
+		if (ipi_dev && ipi_dev->ipi_send)
+			ipi_dev->ipi_send(h);
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+	}
+
+	return 0;
+}
+
+/* Ring the harts an initiator left to us as their group leader */
+static void sbi_ipi_tree_forward(struct sbi_ipi_data *ipi_data)
+{
+	u32 i, h;
+	unsigned long bits;
+
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); i++) {
+		bits = atomic_raw_xchg_ulong(&ipi_data->tree_fwd.bits[i], 0);
+		while (bits) {
+			h = i * BITS_PER_LONG + __ffs(bits);
+			bits &= bits - 1;
+			if (ipi_dev && ipi_dev->ipi_send)
+				ipi_dev->ipi_send(h);
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
+		}
+	}
+}
+
+/*
+ * For M-mode loops that wait on other harts with interrupts off, so harts
+ * we lead are not left waiting for us to get back to sbi_ipi_process().
+ */
+void sbi_ipi_forward(void)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if (ipi_tree)
+		sbi_ipi_tree_forward(sbi_scratch_offset_ptr(scratch,
+							    ipi_data_off));
+}
+
+static int sbi_ipi_targets(struct sbi_domain *dom, ulong hmask, ulong hbase,
+			   struct sbi_hartmask *targets)
 {
 	int rc;
 	ulong i, m;
-	struct sbi_domain *dom = sbi_domain_thishart_ptr();
-	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
+	SBI_HARTMASK_INIT(targets);
 	if (hbase != -1UL) {
 		rc = sbi_hsm_hart_interruptible_mask(dom, hbase, &m);
 		if (rc)
 			return rc;
 		m &= hmask;
 
-		/* Send IPIs */
 		for (i = hbase; m; i++, m >>= 1) {
 			if (m & 1UL)
-				sbi_ipi_send(scratch, i, event, data);
+				sbi_hartmask_set_hart(i, targets);
 		}
 	} else {
 		hbase = 0;
 		while (!sbi_hsm_hart_interruptible_mask(dom, hbase, &m)) {
-			/* Send IPIs */
 			for (i = hbase; m; i++, m >>= 1) {
 				if (m & 1UL)
-					sbi_ipi_send(scratch, i, event, data);
+					sbi_hartmask_set_hart(i, targets);
 			}
 			hbase += BITS_PER_LONG;
 		}
@@ -113,6 +207,70 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 	return 0;
 }
 
+/**
+ * As this this function only handlers scalar values of hart mask, it must be
+ * set to all online harts if the intention is to send IPIs to all the harts.
+ * If hmask is zero, no IPIs will be sent.
+ */
+int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
+{
+	int rc;
+	u32 i, count = 0;
+	struct sbi_hartmask targets;
+	struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if ((SBI_IPI_EVENT_MAX <= event) ||
+	    !ipi_ops_array[event])
+		return SBI_EINVAL;
+
+	rc = sbi_ipi_targets(dom, hmask, hbase, &targets);
+	if (rc)
+		return rc;
+
+	if (ipi_tree && !ipi_ops_array[event]->sync) {
+		sbi_hartmask_for_each_hart(i, &targets)
+			count++;
+		if (count >= SBI_IPI_TREE_MIN_TARGETS)
+			return sbi_ipi_send_tree(scratch, &targets,
+						 event, data);
+	}
+
+	/* Send IPIs */
+	sbi_hartmask_for_each_hart(i, &targets)
+		sbi_ipi_send(scratch, i, event, data);
+
+	return 0;
+}
+
+void sbi_ipi_tree_set_group(u32 hartid, u32 group)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+	struct sbi_ipi_data *ipi_data;
+
+	if (!scratch || !ipi_data_off)
+		return;
+
+	ipi_data = sbi_scratch_offset_ptr(scratch, ipi_data_off);
+	ipi_data->tree_group = group;
+}
+
+void sbi_ipi_tree_enable(bool enable)
+{
+	ipi_tree = enable;
+}
+
+/* Square-ish default: about sqrt(harts) groups of about sqrt(harts) each */
+static void sbi_ipi_tree_default_groups(void)
+{
+	u32 i, fanout = 1, harts = sbi_scratch_last_hartid() + 1;
+
+	while (fanout * fanout < harts)
+		fanout++;
+	for (i = 0; i < harts; i++)
+		sbi_ipi_tree_set_group(i, i / fanout);
+}
+
 int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops)
 {
 	int i, ret = SBI_ENOSPC;
@@ -192,20 +350,25 @@ void sbi_ipi_process(void)
 	if (ipi_dev && ipi_dev->ipi_clear)
 		ipi_dev->ipi_clear(hartid);
 
+	/*
+	 * The clear is an MMIO store and must land before the pending
+	 * bits are taken, or a sender that sets a bit after our xchg
+	 * could have its doorbell wiped by the clear.
+	 */
+	mb();
+
+	/* Our group waits on us, ring it before doing our own share */
+	sbi_ipi_tree_forward(ipi_data);
+
 	ipi_type = atomic_raw_xchg_ulong(&ipi_data->ipi_type, 0);
-	ipi_event = 0;
 	while (ipi_type) {
-		if (!(ipi_type & 1UL))
-			goto skip;
+		ipi_event = __ffs(ipi_type);
+		ipi_type &= ipi_type - 1;
 
 		ipi_ops = ipi_ops_array[ipi_event];
 		if (ipi_ops && ipi_ops->process)
 			ipi_ops->process(scratch);
-
-skip:
-		ipi_type = ipi_type >> 1;
-		ipi_event++;
-	};
+	}
 }
 
 void sbi_ipi_raw_send(u32 target_hart)
@@ -244,6 +407,7 @@ int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (ret < 0)
 			return ret;
 		ipi_halt_event = ret;
+		sbi_ipi_tree_default_groups();
 	} else {
 		if (!ipi_data_off)
 			return SBI_ENOMEM;
@@ -0,0 +1,183 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Lock-free bounded multi-producer single-consumer ring.
+ *
+ * Positions only ever grow; slot pos % num_entries carries a sequence
+ * word that says who may touch it:
+ *
+ *   seq == pos                 free, the producer claiming pos fills it
+ *   seq == pos + 1             published, holds the entry for pos
+ *   seq == (pos + 1) | BUSY    published, claimed by the consumer or by
+ *                              a producer merging into it
+ *   seq == pos + num_entries   consumed, free for the next lap
+ *
+ * Producers claim a position by a cmpxchg on tail, the consumer and
+ * in-place updaters claim a published entry by a cmpxchg on its sequence
+ * word, so an entry is never merged into after the consumer copied it.
+ */
+
+#include <sbi/riscv_atomic.h>
+#include <sbi/riscv_barrier.h>
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_mpsc.h>
+#include <sbi/sbi_string.h>
+
+#define SBI_MPSC_BUSY ((long)(1UL << (BITS_PER_LONG - 1)))
+
+static inline atomic_t *sbi_mpsc_seq(struct sbi_mpsc *q, long pos)
+{
+	return q->queue + (u32)((unsigned long)pos % q->num_entries) *
+				  q->slot_size;
+}
+
+static inline void *sbi_mpsc_entry(atomic_t *seq)
+{
+	return (void *)seq + sizeof(*seq);
+}
+
+void sbi_mpsc_init(struct sbi_mpsc *q, void *queue_mem, u16 entries,
+		   u16 entry_size)
+{
+	u16 i;
+
+	q->queue       = queue_mem;
+	q->num_entries = entries;
+	q->entry_size  = entry_size;
+	q->slot_size   = SBI_MPSC_SLOT_SIZE(entry_size);
+	ATOMIC_INIT(&q->head, 0);
+	ATOMIC_INIT(&q->tail, 0);
+	sbi_memset(q->queue, 0, SBI_MPSC_MEM_SIZE((size_t)entries, entry_size));
+	for (i = 0; i < entries; i++)
+		ATOMIC_INIT(sbi_mpsc_seq(q, i), i);
+}
+
+/* Claimed but not yet published entries count as well */
+u16 sbi_mpsc_avail(struct sbi_mpsc *q)
+{
+	long head, tail;
+
+	if (!q)
+		return 0;
+
+	head = atomic_read(&q->head);
+	tail = atomic_read(&q->tail);
+	if (tail <= head)
+		return 0;
+	return (tail - head > q->num_entries) ? q->num_entries : tail - head;
+}
+
+int sbi_mpsc_is_full(struct sbi_mpsc *q)
+{
+	if (!q)
+		return SBI_EINVAL;
+
+	return sbi_mpsc_avail(q) == q->num_entries;
+}
+
+int sbi_mpsc_is_empty(struct sbi_mpsc *q)
+{
+	if (!q)
+		return SBI_EINVAL;
+
+	return sbi_mpsc_avail(q) == 0;
+}
+
+int sbi_mpsc_enqueue(struct sbi_mpsc *q, void *data)
+{
+	long pos, old, seq;
+	atomic_t *slot;
+
+	if (!q || !data)
+		return SBI_EINVAL;
+
+	pos = atomic_read(&q->tail);
+	while (1) {
+		slot = sbi_mpsc_seq(q, pos);
+		seq  = atomic_read(slot);
+		if (seq == pos) {
+			old = atomic_cmpxchg(&q->tail, pos, pos + 1);
+			if (old == pos)
+				break;
+			pos = old;
+		} else if ((long)(((unsigned long)seq & ~SBI_MPSC_BUSY) - pos) <
+			   0) {
+			/*
+			 * Still holds the entry from the previous lap. A
+			 * claimed entry for pos itself compares as newer once
+			 * BUSY is masked off, so it is not reported as full.
+			 */
+			return SBI_ENOSPC;
+		} else {
+			/* Another producer took pos */
+			pos = atomic_read(&q->tail);
+		}
+	}
+
+	sbi_memcpy(sbi_mpsc_entry(slot), data, q->entry_size);
+	smp_wmb();
+	atomic_write(slot, pos + 1);
+
+	return 0;
+}
+
+int sbi_mpsc_dequeue(struct sbi_mpsc *q, void *data)
+{
+	long pos, seq;
+	atomic_t *slot;
+
+	if (!q || !data)
+		return SBI_EINVAL;
+
+	pos  = atomic_read(&q->head);
+	slot = sbi_mpsc_seq(q, pos);
+	while (1) {
+		seq = atomic_cmpxchg(slot, pos + 1, (pos + 1) | SBI_MPSC_BUSY);
+		if (seq == pos + 1)
+			break;
+		/* Empty, or the producer of pos has not published yet */
+		if (seq != ((pos + 1) | SBI_MPSC_BUSY))
+			return SBI_ENOENT;
+		/* A producer is merging into this entry */
+		cpu_relax();
+	}
+
+	sbi_memcpy(data, sbi_mpsc_entry(slot), q->entry_size);
+	smp_mb();
+	atomic_write(slot, pos + q->num_entries);
+	atomic_write(&q->head, pos + 1);
+
+	return 0;
+}
+
+/**
+ * Same contract as sbi_fifo_inplace_update(), but the callback only holds
+ * the one entry it is given. Entries the consumer or another producer has
+ * claimed are passed over.
+ */
+int sbi_mpsc_inplace_update(struct sbi_mpsc *q, void *in,
+			    int (*fptr)(void *in, void *data))
+{
+	long pos, tail;
+	atomic_t *slot;
+	int ret = SBI_FIFO_UNCHANGED;
+
+	if (!q || !in)
+		return ret;
+
+	tail = atomic_read(&q->tail);
+	for (pos = atomic_read(&q->head); pos < tail; pos++) {
+		slot = sbi_mpsc_seq(q, pos);
+		if (atomic_cmpxchg(slot, pos + 1, (pos + 1) | SBI_MPSC_BUSY) !=
+		    pos + 1)
+			continue;
+		ret = fptr(in, sbi_mpsc_entry(slot));
+		smp_wmb();
+		atomic_write(slot, pos + 1);
+		if (ret == SBI_FIFO_SKIP || ret == SBI_FIFO_UPDATED)
+			break;
+	}
+
+	return ret;
+}
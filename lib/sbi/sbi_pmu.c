@@ -73,6 +73,28 @@ static uint32_t total_ctrs;
 #define get_cidx_type(x) ((x & SBI_PMU_EVENT_IDX_TYPE_MASK) >> 16)
 #define get_cidx_code(x) (x & SBI_PMU_EVENT_IDX_CODE_MASK)
 
+_Static_assert(SBI_PMU_FW_MAX + SBI_PMU_FW_IMPL_MAX - SBI_PMU_FW_IMPL_BASE <=
+		       SBI_PMU_FW_EVENT_MAX,
+	       "fw_event_map cannot hold every firmware event");
+
+/**
+ * Map a firmware event code to its fw_event_map entry. The standard
+ * events come first, the implementation specific ones right after them.
+ * @param fw_evt_code Firmware event code
+ *
+ * Return the entry index, or SBI_EINVAL for an unknown event
+ */
+static int pmu_fw_event_slot(uint32_t fw_evt_code)
+{
+	if (fw_evt_code < SBI_PMU_FW_MAX)
+		return fw_evt_code;
+	if (fw_evt_code >= SBI_PMU_FW_IMPL_BASE &&
+	    fw_evt_code < SBI_PMU_FW_IMPL_MAX)
+		return SBI_PMU_FW_MAX + fw_evt_code - SBI_PMU_FW_IMPL_BASE;
+
+	return SBI_EINVAL;
+}
+
 /**
  * Perform a sanity check on event & counter mappings with event range overlap check
  * @param evtA Pointer to the existing hw event structure
@@ -124,8 +146,12 @@ static int pmu_ctr_read_fw(uint32_t cidx, unsigned long *cval,
 {
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event fevent;
+	int slot = pmu_fw_event_slot(fw_evt_code);
 
-	fevent = fw_event_map[hartid][fw_evt_code];
+	if (slot < 0)
+		return slot;
+
+	fevent = fw_event_map[hartid][slot];
 	*cval = fevent.curr_count;
 
 	return 0;
@@ -266,8 +292,12 @@ static int pmu_ctr_start_fw(uint32_t cidx, uint32_t fw_evt_code,
 {
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event *fevent;
+	int slot = pmu_fw_event_slot(fw_evt_code);
+
+	if (slot < 0)
+		return slot;
 
-	fevent = &fw_event_map[hartid][fw_evt_code];
+	fevent = &fw_event_map[hartid][slot];
 	if (ival_update)
 		fevent->curr_count = ival;
 	fevent->bStarted = TRUE;
@@ -326,8 +356,12 @@ static int pmu_ctr_stop_hw(uint32_t cidx)
 static int pmu_ctr_stop_fw(uint32_t cidx, uint32_t fw_evt_code)
 {
 	u32 hartid = current_hartid();
+	int slot = pmu_fw_event_slot(fw_evt_code);
 
-	fw_event_map[hartid][fw_evt_code].bStarted = FALSE;
+	if (slot < 0)
+		return slot;
+
+	fw_event_map[hartid][slot].bStarted = FALSE;
 
 	return 0;
 }
@@ -468,13 +502,19 @@ int sbi_pmu_ctr_cfg_match(unsigned long cidx_base, unsigned long cidx_mask,
 	u32 hartid = current_hartid();
 	int event_type = get_cidx_type(event_idx);
 	struct sbi_pmu_fw_event *fevent;
-	uint32_t fw_evt_code;
+	int fw_slot = 0;
 	unsigned long tmp = cidx_mask << cidx_base;
 
 	/* Do a basic sanity check of counter base & mask */
 	if (__fls(tmp) >= total_ctrs || event_type >= SBI_PMU_EVENT_TYPE_MAX)
 		return SBI_EINVAL;
 
+	if (event_type == SBI_PMU_EVENT_TYPE_FW) {
+		fw_slot = pmu_fw_event_slot(get_cidx_code(event_idx));
+		if (fw_slot < 0)
+			return SBI_EINVAL;
+	}
+
 	if (flags & SBI_PMU_CFG_FLAG_SKIP_MATCH) {
 		/* The caller wants to skip the match because it already knows the
 		 * counter idx for the given event. Verify that the counter idx
@@ -504,8 +544,7 @@ skip_match:
 		if (flags & SBI_PMU_CFG_FLAG_AUTO_START)
 			pmu_ctr_start_hw(ctr_idx, 0, false);
 	} else if (event_type == SBI_PMU_EVENT_TYPE_FW) {
-		fw_evt_code = get_cidx_code(event_idx);
-		fevent = &fw_event_map[hartid][fw_evt_code];
+		fevent = &fw_event_map[hartid][fw_slot];
 		if (flags & SBI_PMU_CFG_FLAG_CLEAR_VALUE)
 			fevent->curr_count = 0;
 		if (flags & SBI_PMU_CFG_FLAG_AUTO_START)
@@ -519,11 +558,12 @@ inline int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 {
 	u32 hartid = current_hartid();
 	struct sbi_pmu_fw_event *fevent;
+	int slot = pmu_fw_event_slot(fw_id);
 
-	if (unlikely(fw_id >= SBI_PMU_FW_MAX))
+	if (unlikely(slot < 0))
 		return SBI_EINVAL;
 
-	fevent = &fw_event_map[hartid][fw_id];
+	fevent = &fw_event_map[hartid][slot];
 
 	/* PMU counters will be only enabled during performance debugging */
 	if (unlikely(fevent->bStarted))
@@ -574,7 +614,7 @@ static void pmu_reset_event_map(u32 hartid)
 	/* Initialize the counter to event mapping table */
 	for (j = 3; j < total_ctrs; j++)
 		active_events[hartid][j] = SBI_PMU_EVENT_IDX_INVALID;
-	for (j = 0; j < SBI_PMU_FW_CTR_MAX; j++)
+	for (j = 0; j < SBI_PMU_FW_EVENT_MAX; j++)
 		sbi_memset(&fw_event_map[hartid][j], 0,
 			   sizeof(struct sbi_pmu_fw_event));
 }
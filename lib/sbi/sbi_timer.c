@@ -18,9 +18,19 @@
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
 
+/* Pending M-timer deadlines of a HART, -1 when unused */
+struct timer_events {
+	u64 smode_next;
+	u64 fw_next;
+	/* S-mode timer events started so far, a liveness hint */
+	unsigned long smode_starts;
+};
+
 static unsigned long time_delta_off;
+static unsigned long time_events_off;
 static u64 (*get_time_val)(void);
 static const struct sbi_timer_device *timer_dev = NULL;
+static void (*fw_event_fn)(void);
 
 #if __riscv_xlen == 32
 static u64 get_ticks(void)
@@ -121,19 +131,78 @@ void sbi_timer_set_delta_upper(ulong delta_upper)
 	*time_delta |= ((u64)delta_upper << 32);
 }
 
+static struct timer_events *timer_events_thishart(void)
+{
+	return sbi_scratch_thishart_offset_ptr(time_events_off);
+}
+
+/* Program the M-timer for whichever deadline comes first */
+static void timer_events_arm(struct timer_events *ev)
+{
+	u64 next = ev->smode_next < ev->fw_next ? ev->smode_next : ev->fw_next;
+
+	if (next == -1ULL) {
+		csr_clear(CSR_MIE, MIP_MTIP);
+		return;
+	}
+	if (timer_dev && timer_dev->timer_event_start)
+		timer_dev->timer_event_start(next);
+	csr_set(CSR_MIE, MIP_MTIP);
+}
+
 void sbi_timer_event_start(u64 next_event)
 {
+	struct timer_events *ev = timer_events_thishart();
+
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SET_TIMER);
-	if (timer_dev && timer_dev->timer_event_start)
-		timer_dev->timer_event_start(next_event);
+	ev->smode_next = next_event;
+	ev->smode_starts++;
+	timer_events_arm(ev);
 	csr_clear(CSR_MIP, MIP_STIP);
-	csr_set(CSR_MIE, MIP_MTIP);
+}
+
+void sbi_timer_fw_event_start(u64 next_event)
+{
+	struct timer_events *ev = timer_events_thishart();
+
+	ev->fw_next = next_event;
+	timer_events_arm(ev);
+}
+
+void sbi_timer_fw_event_stop(void)
+{
+	struct timer_events *ev = timer_events_thishart();
+
+	ev->fw_next = -1ULL;
+	timer_events_arm(ev);
+}
+
+unsigned long sbi_timer_smode_starts(void)
+{
+	return timer_events_thishart()->smode_starts;
+}
+
+void sbi_timer_set_fw_handler(void (*fn)(void))
+{
+	fw_event_fn = fn;
 }
 
 void sbi_timer_process(void)
 {
-	csr_clear(CSR_MIE, MIP_MTIP);
-	csr_set(CSR_MIP, MIP_STIP);
+	struct timer_events *ev = timer_events_thishart();
+	u64 now = sbi_timer_value();
+
+	if (ev->fw_next <= now) {
+		ev->fw_next = -1ULL;
+		/* The handler may start the next firmware event */
+		if (fw_event_fn)
+			fw_event_fn();
+	}
+	if (ev->smode_next <= now) {
+		ev->smode_next = -1ULL;
+		csr_set(CSR_MIP, MIP_STIP);
+	}
+	timer_events_arm(ev);
 }
 
 const struct sbi_timer_device *sbi_timer_get_device(void)
@@ -154,6 +223,7 @@ void sbi_timer_set_device(const struct sbi_timer_device *dev)
 int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	u64 *time_delta;
+	struct timer_events *ev;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
@@ -161,16 +231,27 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (!time_delta_off)
 			return SBI_ENOMEM;
 
+		time_events_off = sbi_scratch_alloc_offset(sizeof(*ev));
+		if (!time_events_off) {
+			sbi_scratch_free_offset(time_delta_off);
+			return SBI_ENOMEM;
+		}
+
 		if (sbi_hart_has_feature(scratch, SBI_HART_HAS_TIME))
 			get_time_val = get_ticks;
 	} else {
-		if (!time_delta_off)
+		if (!time_delta_off || !time_events_off)
 			return SBI_ENOMEM;
 	}
 
 	time_delta = sbi_scratch_offset_ptr(scratch, time_delta_off);
 	*time_delta = 0;
 
+	ev = sbi_scratch_offset_ptr(scratch, time_events_off);
+	ev->smode_next = -1ULL;
+	ev->fw_next = -1ULL;
+	ev->smode_starts = 0;
+
 	return sbi_platform_timer_init(plat, cold_boot);
 }
 
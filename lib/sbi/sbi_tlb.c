@@ -15,6 +15,7 @@
 #include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_ipi.h>
+#include <sbi/sbi_mpsc.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_tlb.h>
 #include <sbi/sbi_hfence.h>
@@ -26,13 +27,62 @@
 static unsigned long tlb_sync_off;
 static unsigned long tlb_fifo_off;
 static unsigned long tlb_fifo_mem_off;
+static unsigned long tlb_bcast_off;
 static unsigned long tlb_range_flush_limit;
 
+/*
+ * A fence aimed at several harts is published once, in the initiating
+ * hart's scratch space, and the targets run it by reference instead of
+ * each getting a copy in its fifo.
+ */
+struct tlb_bcast {
+	struct sbi_tlb_info info;
+	/* Harts whose published fence this hart still has to run */
+	struct sbi_hartmask srcs;
+};
+
+#define TLB_CACHE_LINE_SIZE		64
+#define TLB_SYNC_BACKOFF_MAX		256
+
+/*
+ * Fence completion count of a source hart. Every target bumps done once
+ * per request it ran on our behalf, and we wait for done to reach issued.
+ * done has a cache line to itself so the targets' increments do not keep
+ * stealing the line holding our own state.
+ */
+struct tlb_completion {
+	atomic_t done __aligned(TLB_CACHE_LINE_SIZE);
+	/* Only ever touched by the owning hart */
+	unsigned long issued __aligned(TLB_CACHE_LINE_SIZE);
+};
+
+/* Scratch offsets are only pointer aligned, the slot has room to round up */
+static inline struct tlb_completion *tlb_completion_ptr(
+						struct sbi_scratch *scratch)
+{
+	unsigned long p = (unsigned long)sbi_scratch_offset_ptr(scratch,
+								tlb_sync_off);
+
+	p = (p + TLB_CACHE_LINE_SIZE - 1) & ~(TLB_CACHE_LINE_SIZE - 1);
+	return (struct tlb_completion *)p;
+}
+
+static inline void tlb_complete(struct sbi_scratch *rscratch)
+{
+	atomic_add_return(&tlb_completion_ptr(rscratch)->done, 1);
+}
+
 static void tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
 }
 
+static inline bool tlb_has_svinval(void)
+{
+	return sbi_hart_has_feature(sbi_scratch_thishart_ptr(),
+				    SBI_HART_HAS_SVINVAL);
+}
+
 void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
@@ -50,6 +100,14 @@ void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_vvma_va(start + i);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_vvma_va(start+i);
 	}
@@ -71,21 +129,28 @@ void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_gvma_gpa(start + i);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_gvma_gpa(start+i);
 	}
 }
 
-void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
+static void tlb_sfence_vma_range(unsigned long start, unsigned long size)
 {
-	unsigned long start = tinfo->start;
-	unsigned long size  = tinfo->size;
 	unsigned long i;
 
-	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
-
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
-		tlb_flush_all();
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_sinval_vma_va(start + i);
+		__sbi_sfence_inval_ir();
 		return;
 	}
 
@@ -97,6 +162,21 @@ void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 	}
 }
 
+void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
+{
+	unsigned long start = tinfo->start;
+	unsigned long size  = tinfo->size;
+
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
+
+	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+		tlb_flush_all();
+		return;
+	}
+
+	tlb_sfence_vma_range(start, size);
+}
+
 void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
@@ -120,6 +200,14 @@ void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 		goto done;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_vvma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		goto done;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_vvma_asid_va(start + i, asid);
 	}
@@ -147,6 +235,14 @@ void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_hinval_gvma_vmid_gpa(start + i, vmid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__sbi_hfence_gvma_vmid_gpa(start + i, vmid);
 	}
@@ -175,6 +271,14 @@ void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 		return;
 	}
 
+	if (tlb_has_svinval()) {
+		__sbi_sfence_w_inval();
+		for (i = 0; i < size; i += PAGE_SIZE)
+			__sbi_sinval_vma_asid_va(start + i, asid);
+		__sbi_sfence_inval_ir();
+		return;
+	}
+
 	for (i = 0; i < size; i += PAGE_SIZE) {
 		__asm__ __volatile__("sfence.vma %0, %1"
 				     :
@@ -215,7 +319,6 @@ static void tlb_entry_process(struct sbi_tlb_info *tinfo)
 {
 	u32 rhartid;
 	struct sbi_scratch *rscratch = NULL;
-	unsigned long *rtlb_sync = NULL;
 
 	tinfo->local_fn(tinfo);
 
@@ -224,8 +327,7 @@ static void tlb_entry_process(struct sbi_tlb_info *tinfo)
 		if (!rscratch)
 			continue;
 
-		rtlb_sync = sbi_scratch_offset_ptr(rscratch, tlb_sync_off);
-		while (atomic_raw_xchg_ulong(rtlb_sync, 1)) ;
+		tlb_complete(rscratch);
 	}
 }
 
@@ -233,10 +335,10 @@ static void tlb_process_count(struct sbi_scratch *scratch, int count)
 {
 	struct sbi_tlb_info tinfo;
 	unsigned int deq_count = 0;
-	struct sbi_fifo *tlb_fifo =
+	struct sbi_mpsc *tlb_fifo =
 			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
-	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
+	while (!sbi_mpsc_dequeue(tlb_fifo, &tinfo)) {
 		tlb_entry_process(&tinfo);
 		deq_count++;
 		if (deq_count > count)
@@ -248,27 +350,64 @@ static void tlb_process_count(struct sbi_scratch *scratch, int count)
 static void tlb_process(struct sbi_scratch *scratch)
 {
 	struct sbi_tlb_info tinfo;
-	struct sbi_fifo *tlb_fifo =
+	struct sbi_mpsc *tlb_fifo =
 			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 
-	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo))
+	while (!sbi_mpsc_dequeue(tlb_fifo, &tinfo))
 		tlb_entry_process(&tinfo);
 }
 
+static void tlb_bcast_process(struct sbi_scratch *scratch)
+{
+	u32 i, rhartid;
+	unsigned long bits;
+	struct sbi_scratch *rscratch;
+	struct tlb_bcast *src;
+	struct tlb_bcast *bcast = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+
+	for (i = 0; i < BITS_TO_LONGS(SBI_HARTMASK_MAX_BITS); i++) {
+		bits = atomic_raw_xchg_ulong(&bcast->srcs.bits[i], 0);
+		while (bits) {
+			rhartid = i * BITS_PER_LONG + __ffs(bits);
+			bits &= bits - 1;
+			rscratch = sbi_hartid_to_scratch(rhartid);
+			if (!rscratch)
+				continue;
+			src = sbi_scratch_offset_ptr(rscratch, tlb_bcast_off);
+			src->info.local_fn(&src->info);
+			tlb_complete(rscratch);
+		}
+	}
+}
+
 static void tlb_sync(struct sbi_scratch *scratch)
 {
-	unsigned long *tlb_sync =
-			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
+	struct tlb_completion *comp = tlb_completion_ptr(scratch);
+	unsigned long i, spins = 1;
 
-	while (!atomic_raw_xchg_ulong(tlb_sync, 0)) {
+	while ((long)(comp->issued - atomic_read(&comp->done)) > 0) {
 		/*
-		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
+		 * While we are waiting for the targets to complete,
+		 * consume fifo requests and broadcasts to avoid deadlock,
+		 * their initiators may be waiting on us in turn.
 		 */
 		tlb_process_count(scratch, 1);
+		tlb_bcast_process(scratch);
+		sbi_ipi_forward();
+
+		/* Back off so the targets get the done line to themselves */
+		for (i = 0; i < spins; i++)
+			cpu_relax();
+		spins = MIN(spins << 1, (unsigned long)TLB_SYNC_BACKOFF_MAX);
 	}
+}
 
-	return;
+/* Full flushes cover any range; (0, 0) also covers every ASID and VMID */
+static inline int tlb_range_rank(struct sbi_tlb_info *tinfo)
+{
+	if (tinfo->start == 0 && tinfo->size == 0)
+		return 2;
+	return (tinfo->size == SBI_TLB_FLUSH_ALL) ? 1 : 0;
 }
 
 static inline int tlb_range_check(struct sbi_tlb_info *curr,
@@ -276,38 +415,87 @@ static inline int tlb_range_check(struct sbi_tlb_info *curr,
 {
 	unsigned long curr_end;
 	unsigned long next_end;
+	int curr_rank, next_rank;
 	int ret = SBI_FIFO_UNCHANGED;
 
 	if (!curr || !next)
 		return ret;
 
+	curr_rank = tlb_range_rank(curr);
+	next_rank = tlb_range_rank(next);
+	if (curr_rank || next_rank) {
+		if (next_rank > curr_rank) {
+			curr->start = next->start;
+			curr->size  = next->size;
+			ret = SBI_FIFO_UPDATED;
+		} else {
+			ret = SBI_FIFO_SKIP;
+		}
+		goto merged;
+	}
+
 	next_end = next->start + next->size;
 	curr_end = curr->start + curr->size;
-	if (next->start <= curr->start && next_end > curr_end) {
-		curr->start = next->start;
-		curr->size  = next->size;
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_UPDATED;
-	} else if (next->start >= curr->start && next_end <= curr_end) {
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+	/* Neither overlapping nor adjacent */
+	if (next->start > curr_end || curr->start > next_end)
+		return ret;
+
+	if (next->start >= curr->start && next_end <= curr_end) {
 		ret = SBI_FIFO_SKIP;
+		goto merged;
+	}
+
+	curr->start = MIN(curr->start, next->start) & ~(PAGE_SIZE - 1);
+	curr_end = (MAX(curr_end, next_end) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	curr->size = curr_end - curr->start;
+	/* Same bound a single request of this size gets */
+	if (curr->size > tlb_range_flush_limit) {
+		curr->start = 0;
+		curr->size = SBI_TLB_FLUSH_ALL;
 	}
+	ret = SBI_FIFO_UPDATED;
 
+merged:
+	sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
 	return ret;
 }
 
+/* Requests whose ranges may be merged: same fence, same ASID/VMID */
+static inline bool tlb_same_context(struct sbi_tlb_info *curr,
+				    struct sbi_tlb_info *next)
+{
+	if (curr->local_fn != next->local_fn)
+		return FALSE;
+
+	if (curr->local_fn == sbi_tlb_local_sfence_vma_asid)
+		return curr->asid == next->asid;
+	if (curr->local_fn == sbi_tlb_local_hfence_gvma_vmid ||
+	    curr->local_fn == sbi_tlb_local_hfence_vvma)
+		return curr->vmid == next->vmid;
+	if (curr->local_fn == sbi_tlb_local_hfence_vvma_asid)
+		return curr->asid == next->asid && curr->vmid == next->vmid;
+
+	return TRUE;
+}
+
 /**
  * Call back to decide if an inplace fifo update is required or next entry can
- * can be skipped. Here are the different cases that are being handled.
+ * can be skipped. Both entries must be the same kind of fence for the same
+ * ASID and/or VMID. Here are the different cases that are being handled.
  *
  * Case1:
  *	if next flush request range lies within one of the existing entry, skip
- *	the next entry.
+ *	the next entry. A queued FENCE.I covers any later one.
  * Case2:
- *	if flush request range in current fifo entry lies within next flush
- *	request, update the current entry.
+ *	if next flush request range overlaps or is adjacent to the one in the
+ *	current fifo entry, widen the current entry to the page aligned union.
+ *	A union beyond tlb_range_flush_limit becomes a full flush.
  *
  * Note:
+ *	The callback runs with only the entry it is given claimed; the consumer
+ *	cannot take that entry until we return, so a merged-in request is always
+ *	processed and counted as complete for its source.
+ *
  *	We can not issue a fifo reset anymore if a complete vma flush is requested.
  *	This is because we are queueing FENCE.I requests as well now.
  *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
@@ -326,16 +514,15 @@ static int tlb_update_cb(void *in, void *data)
 	curr = (struct sbi_tlb_info *)data;
 	next = (struct sbi_tlb_info *)in;
 
-	if (next->local_fn == sbi_tlb_local_sfence_vma_asid &&
-	    curr->local_fn == sbi_tlb_local_sfence_vma_asid) {
-		if (next->asid == curr->asid)
-			ret = tlb_range_check(curr, next);
-	} else if (next->local_fn == sbi_tlb_local_sfence_vma &&
-		   curr->local_fn == sbi_tlb_local_sfence_vma) {
-		ret = tlb_range_check(curr, next);
+	if (!tlb_same_context(curr, next))
+		return ret;
+
+	if (curr->local_fn == sbi_tlb_local_fence_i) {
+		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+		return SBI_FIFO_SKIP;
 	}
 
-	return ret;
+	return tlb_range_check(curr, next);
 }
 
 static int tlb_update(struct sbi_scratch *scratch,
@@ -343,20 +530,10 @@ static int tlb_update(struct sbi_scratch *scratch,
 			  u32 remote_hartid, void *data)
 {
 	int ret;
-	struct sbi_fifo *tlb_fifo_r;
+	struct sbi_mpsc *tlb_fifo_r;
 	struct sbi_tlb_info *tinfo = data;
 	u32 curr_hartid = current_hartid();
 
-	/*
-	 * If address range to flush is too big then simply
-	 * upgrade it to flush all because we can only flush
-	 * 4KB at a time.
-	 */
-	if (tinfo->size > tlb_range_flush_limit) {
-		tinfo->start = 0;
-		tinfo->size = SBI_TLB_FLUSH_ALL;
-	}
-
 	/*
 	 * If the request is to queue a tlb flush entry for itself
 	 * then just do a local flush and return;
@@ -368,12 +545,15 @@ static int tlb_update(struct sbi_scratch *scratch,
 
 	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
 
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, tlb_update_cb);
+	tlb_completion_ptr(scratch)->issued++;
+
+	ret = sbi_mpsc_inplace_update(tlb_fifo_r, data, tlb_update_cb);
 	if (ret != SBI_FIFO_UNCHANGED) {
+		sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_MERGED);
 		return 1;
 	}
 
-	while (sbi_fifo_enqueue(tlb_fifo_r, data) < 0) {
+	while (sbi_mpsc_enqueue(tlb_fifo_r, data) < 0) {
 		/**
 		 * For now, Busy loop until there is space in the fifo.
 		 * There may be case where target hart is also
@@ -383,9 +563,12 @@ static int tlb_update(struct sbi_scratch *scratch,
 		 * this properly.
 		 */
 		tlb_process_count(scratch, 1);
+		/* The owner may be waiting on a group we have yet to ring */
+		sbi_ipi_forward();
 		sbi_dprintf("hart%d: hart%d tlb fifo full\n",
 			    curr_hartid, remote_hartid);
 	}
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_FENCE_QUEUED);
 
 	return 0;
 }
@@ -399,26 +582,138 @@ static struct sbi_ipi_event_ops tlb_ops = {
 
 static u32 tlb_event = SBI_IPI_EVENT_MAX;
 
+static int tlb_bcast_update(struct sbi_scratch *scratch,
+			    struct sbi_scratch *remote_scratch,
+			    u32 remote_hartid, void *data)
+{
+	u32 curr_hartid = current_hartid();
+	struct tlb_bcast *bcast = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+	struct tlb_bcast *rbcast;
+
+	if (remote_hartid == curr_hartid) {
+		bcast->info.local_fn(&bcast->info);
+		return -1;
+	}
+
+	rbcast = sbi_scratch_offset_ptr(remote_scratch, tlb_bcast_off);
+	tlb_completion_ptr(scratch)->issued++;
+	atomic_raw_set_bit(curr_hartid, rbcast->srcs.bits);
+
+	return 0;
+}
+
+static struct sbi_ipi_event_ops tlb_bcast_ops = {
+	.name = "IPI_TLB_BCAST",
+	.update = tlb_bcast_update,
+	.process = tlb_bcast_process,
+};
+
+static u32 tlb_bcast_event = SBI_IPI_EVENT_MAX;
+
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 {
+	int ret;
+	struct sbi_scratch *scratch;
+	struct tlb_bcast *bcast;
+
 	if (!tinfo->local_fn)
 		return SBI_EINVAL;
 
 	tlb_pmu_incr_fw_ctr(tinfo);
 
-	return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
+	/*
+	 * If address range to flush is too big then simply
+	 * upgrade it to flush all because we can only flush
+	 * 4KB at a time.
+	 */
+	if (tinfo->size > tlb_range_flush_limit) {
+		tinfo->start = 0;
+		tinfo->size = SBI_TLB_FLUSH_ALL;
+	}
+
+	/* A single target gains nothing from sharing, keep it mergeable */
+	if (hbase != -1UL && !(hmask & (hmask - 1)))
+		return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
+
+	scratch = sbi_scratch_thishart_ptr();
+	bcast = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
+	sbi_memcpy(&bcast->info, tinfo, sizeof(*tinfo));
+	smp_wmb();
+	ret = sbi_ipi_send_many(hmask, hbase, tlb_bcast_event, NULL);
+	/* Every target has run our descriptor once this returns */
+	tlb_sync(scratch);
+
+	return ret;
+}
+
+/*
+ * Range flush calibration. A range costs one invalidate per page, a full
+ * flush costs one fence plus refilling whatever the interrupted context
+ * had mapped. The refill is modelled as TLB_CALIB_REFILL_PAGES walks of
+ * TLB_CALIB_WALK_LEVELS page-stride loads each.
+ */
+#define TLB_CALIB_ROUNDS		8
+#define TLB_CALIB_PAGES			16
+#define TLB_CALIB_TOUCH_PAGES		64
+#define TLB_CALIB_REFILL_PAGES		32
+#define TLB_CALIB_WALK_LEVELS		3
+#define TLB_CALIB_MAX_PAGES		512
+
+static unsigned long tlb_calibrate_flush_limit(struct sbi_scratch *scratch)
+{
+	unsigned long base = scratch->fw_start;
+	unsigned long page_cost = -1UL, full_cost = -1UL;
+	unsigned long i, t, pages, touch_cost = 0;
+
+	/* Only the first pass counts, later ones would hit in the cache */
+	pages = MIN(scratch->fw_size >> PAGE_SHIFT, TLB_CALIB_TOUCH_PAGES);
+	t = csr_read(CSR_MCYCLE);
+	for (i = 0; i < pages; i++)
+		(void)*(volatile unsigned long *)(base + (i << PAGE_SHIFT));
+	if (pages)
+		touch_cost = (csr_read(CSR_MCYCLE) - t) / pages;
+
+	/* Best of several rounds, this early nothing else should interfere */
+	for (i = 0; i < TLB_CALIB_ROUNDS; i++) {
+		t = csr_read(CSR_MCYCLE);
+		tlb_sfence_vma_range(base, TLB_CALIB_PAGES << PAGE_SHIFT);
+		page_cost = MIN(page_cost, csr_read(CSR_MCYCLE) - t);
+
+		t = csr_read(CSR_MCYCLE);
+		tlb_flush_all();
+		full_cost = MIN(full_cost, csr_read(CSR_MCYCLE) - t);
+	}
+
+	/* mcycle is not counting, nothing to go by */
+	if (!page_cost)
+		return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+
+	page_cost = MAX(page_cost / TLB_CALIB_PAGES, 1UL);
+	full_cost += TLB_CALIB_REFILL_PAGES * TLB_CALIB_WALK_LEVELS * touch_cost;
+	pages = CLAMP(full_cost / page_cost, 1UL,
+		      (unsigned long)TLB_CALIB_MAX_PAGES);
+
+	return pages << PAGE_SHIFT;
+}
+
+unsigned long sbi_tlb_range_flush_limit(void)
+{
+	return tlb_range_flush_limit;
 }
 
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	int ret;
+	u64 limit;
 	void *tlb_mem;
-	unsigned long *tlb_sync;
-	struct sbi_fifo *tlb_q;
+	struct tlb_completion *comp;
+	struct sbi_mpsc *tlb_q;
+	struct tlb_bcast *bcast;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
-		tlb_sync_off = sbi_scratch_alloc_offset(sizeof(*tlb_sync));
+		tlb_sync_off = sbi_scratch_alloc_offset(sizeof(*comp) +
+							TLB_CACHE_LINE_SIZE);
 		if (!tlb_sync_off)
 			return SBI_ENOMEM;
 		tlb_fifo_off = sbi_scratch_alloc_offset(sizeof(*tlb_q));
@@ -427,37 +722,63 @@ int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 			return SBI_ENOMEM;
 		}
 		tlb_fifo_mem_off = sbi_scratch_alloc_offset(
-				SBI_TLB_FIFO_NUM_ENTRIES * SBI_TLB_INFO_SIZE);
+				SBI_MPSC_MEM_SIZE(SBI_TLB_FIFO_NUM_ENTRIES,
+						  SBI_TLB_INFO_SIZE));
 		if (!tlb_fifo_mem_off) {
 			sbi_scratch_free_offset(tlb_fifo_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
+		tlb_bcast_off = sbi_scratch_alloc_offset(sizeof(*bcast));
+		if (!tlb_bcast_off) {
+			sbi_scratch_free_offset(tlb_fifo_mem_off);
+			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_sync_off);
+			return SBI_ENOMEM;
+		}
 		ret = sbi_ipi_event_create(&tlb_ops);
 		if (ret < 0) {
+			sbi_scratch_free_offset(tlb_bcast_off);
 			sbi_scratch_free_offset(tlb_fifo_mem_off);
 			sbi_scratch_free_offset(tlb_fifo_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return ret;
 		}
 		tlb_event = ret;
-		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
+		ret = sbi_ipi_event_create(&tlb_bcast_ops);
+		if (ret < 0) {
+			sbi_ipi_event_destroy(tlb_event);
+			sbi_scratch_free_offset(tlb_bcast_off);
+			sbi_scratch_free_offset(tlb_fifo_mem_off);
+			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_sync_off);
+			return ret;
+		}
+		tlb_bcast_event = ret;
+		limit = sbi_platform_tlbr_flush_limit(plat);
+		if (limit == SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_CALIBRATE)
+			limit = tlb_calibrate_flush_limit(scratch);
+		tlb_range_flush_limit = limit;
 	} else {
 		if (!tlb_sync_off ||
 		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_fifo_mem_off ||
+		    !tlb_bcast_off)
 			return SBI_ENOMEM;
-		if (SBI_IPI_EVENT_MAX <= tlb_event)
+		if (SBI_IPI_EVENT_MAX <= tlb_event ||
+		    SBI_IPI_EVENT_MAX <= tlb_bcast_event)
 			return SBI_ENOSPC;
 	}
 
-	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
+	comp = tlb_completion_ptr(scratch);
 	tlb_q = sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
 	tlb_mem = sbi_scratch_offset_ptr(scratch, tlb_fifo_mem_off);
+	bcast = sbi_scratch_offset_ptr(scratch, tlb_bcast_off);
 
-	*tlb_sync = 0;
+	sbi_memset(comp, 0, sizeof(*comp));
+	sbi_memset(bcast, 0, sizeof(*bcast));
 
-	sbi_fifo_init(tlb_q, tlb_mem,
+	sbi_mpsc_init(tlb_q, tlb_mem,
 		      SBI_TLB_FIFO_NUM_ENTRIES, SBI_TLB_INFO_SIZE);
 
 	return 0;
@@ -21,7 +21,9 @@
 #include <sbi/sbi_timer.h>
 #include <sbi/sbi_trap.h>
 #include <sbi_utils/rvbt/rvbt_breakpoint.h>
+#include <sbi_utils/rvbt/rvbt_coverage.h>
 #include <sbi_utils/rvbt/rvbt_init.h>
+#include <sbi_utils/rvbt/rvbt_watchpoint.h>
 
 static void __noreturn sbi_trap_error(const char *msg, int rc,
 				      ulong mcause, ulong mtval, ulong mtval2,
@@ -226,6 +228,9 @@ struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs)
 		mtinst = csr_read(CSR_MTINST);
 	}
 
+	/* Pick up breakpoints set by another hart since we last trapped */
+	rvbt_sync_breakpoint();
+
 	if (mcause & (1UL << (__riscv_xlen - 1))) {
 		mcause &= ~(1UL << (__riscv_xlen - 1));
 		switch (mcause) {
@@ -263,12 +268,23 @@ struct sbi_trap_regs *sbi_trap_handler(struct sbi_trap_regs *regs)
   case CAUSE_FETCH_ACCESS:
     rc = rvbt_loop(regs);
     break;
+	case CAUSE_BREAKPOINT:
+		if (rvbt_cov_hit(regs)) {
+			rc = 0;
+			break;
+		}
+		goto redirect;
 	case CAUSE_LOAD_ACCESS:
 	case CAUSE_STORE_ACCESS:
+		if (rvbt_watch_access(mcause, mtval, regs)) {
+			rc = 0;
+			break;
+		}
 		sbi_pmu_ctr_incr_fw(mcause == CAUSE_LOAD_ACCESS ?
 			SBI_PMU_FW_ACCESS_LOAD : SBI_PMU_FW_ACCESS_STORE);
 		/* fallthrough */
 	default:
+redirect:
 		/* If the trap came from S or U mode, redirect it there */
 		trap.epc = regs->mepc;
 		trap.cause = mcause;
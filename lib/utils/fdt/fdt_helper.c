@@ -290,6 +290,31 @@ int fdt_parse_timebase_frequency(void *fdt, unsigned long *freq)
 	return 0;
 }
 
+int fdt_parse_tlb_range_flush_limit(void *fdt, u64 *limit)
+{
+	const fdt32_t *val;
+	int len, chosen_offset;
+
+	if (!fdt || !limit)
+		return SBI_EINVAL;
+
+	chosen_offset = fdt_path_offset(fdt, "/chosen");
+	if (chosen_offset < 0)
+		return chosen_offset;
+
+	val = fdt_getprop(fdt, chosen_offset,
+			  "opensbi,tlb-range-flush-limit", &len);
+	if (!val || len <= 0)
+		return SBI_ENOENT;
+
+	/* One or two cells, like a reg size */
+	*limit = fdt32_to_cpu(val[0]);
+	if (len >= 2 * sizeof(fdt32_t))
+		*limit = (*limit << 32) | fdt32_to_cpu(val[1]);
+
+	return 0;
+}
+
 int fdt_parse_gaisler_uart_node(void *fdt, int nodeoffset,
 				struct platform_uart_data *uart)
 {
@@ -7,7 +7,9 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <libfdt.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_ipi.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi_utils/fdt/fdt_helper.h>
 #include <sbi_utils/ipi/fdt_ipi.h>
@@ -40,6 +42,54 @@ static int fdt_ipi_warm_init(void)
 	return 0;
 }
 
+/*
+ * Every node of the cpu-map whose children name cpus directly (a cluster of
+ * cores, or a core of threads) becomes one tree fan-out group.
+ */
+static void fdt_ipi_tree_walk(void *fdt, int nodeoff, u32 *group)
+{
+	int child, cpuoff, len;
+	const fdt32_t *val;
+	bool leaf = FALSE;
+	u32 hartid;
+
+	fdt_for_each_subnode(child, fdt, nodeoff) {
+		val = fdt_getprop(fdt, child, "cpu", &len);
+		if (!val || len < (int)sizeof(fdt32_t)) {
+			fdt_ipi_tree_walk(fdt, child, group);
+			continue;
+		}
+		cpuoff = fdt_node_offset_by_phandle(fdt, fdt32_to_cpu(*val));
+		if (cpuoff < 0 || fdt_parse_hart_id(fdt, cpuoff, &hartid))
+			continue;
+		sbi_ipi_tree_set_group(hartid, *group);
+		leaf = TRUE;
+	}
+	if (leaf)
+		(*group)++;
+}
+
+/*
+ * Tree fan-out is opt-in with "opensbi,ipi-tree" in /chosen. Groups follow
+ * /cpus/cpu-map when there is one, otherwise the hart count based default
+ * sbi_ipi_init() set up stays.
+ */
+static void fdt_ipi_tree_init(void *fdt)
+{
+	int chosen, map;
+	u32 group = 0;
+
+	chosen = fdt_path_offset(fdt, "/chosen");
+	if (chosen < 0 || !fdt_getprop(fdt, chosen, "opensbi,ipi-tree", NULL))
+		return;
+
+	map = fdt_path_offset(fdt, "/cpus/cpu-map");
+	if (map >= 0)
+		fdt_ipi_tree_walk(fdt, map, &group);
+
+	sbi_ipi_tree_enable(TRUE);
+}
+
 static int fdt_ipi_cold_init(void)
 {
 	int pos, noff, rc;
@@ -67,6 +117,8 @@ static int fdt_ipi_cold_init(void)
 			break;
 	}
 
+	fdt_ipi_tree_init(fdt);
+
 	return 0;
 }
 
@@ -1,6 +1,18 @@
 libsbiutils-objs-y += rvbt/rvbt_stepping.o
 libsbiutils-objs-y += rvbt/rvbt_init.o
+libsbiutils-objs-y += rvbt/rvbt_hart.o
 libsbiutils-objs-y += rvbt/rvbt_breakpoint.o
+libsbiutils-objs-y += rvbt/rvbt_coredump.o
+libsbiutils-objs-y += rvbt/rvbt_coverage.o
+libsbiutils-objs-y += rvbt/rvbt_find.o
+libsbiutils-objs-y += rvbt/rvbt_ftrace.o
+libsbiutils-objs-y += rvbt/rvbt_watchpoint.o
 libsbiutils-objs-y += rvbt/rvbt_memory.o
+libsbiutils-objs-y += rvbt/rvbt_profile.o
 libsbiutils-objs-y += rvbt/rvbt_serial.o
+libsbiutils-objs-y += rvbt/rvbt_smp.o
+libsbiutils-objs-y += rvbt/rvbt_snap.o
+libsbiutils-objs-y += rvbt/rvbt_trace.o
+libsbiutils-objs-y += rvbt/rvbt_timer.o
+libsbiutils-objs-y += rvbt/rvbt_watchdog.o
 libsbiutils-objs-y += rvbt/mfmt.o
@@ -1,71 +1,452 @@
 #include "sbi/riscv_asm.h"
 #include "sbi/riscv_atomic.h"
+#include "sbi/riscv_barrier.h"
 #include "sbi/riscv_encoding.h"
+#include "sbi/riscv_locks.h"
+#include "sbi/sbi_error.h"
 #include "sbi/sbi_ipi.h"
 #include "sbi_utils/rvbt/rvbt_stepping.h"
 #include <sbi_utils/rvbt/rvbt_breakpoint.h>
+#include <sbi_utils/rvbt/rvbt_coverage.h>
+#include <sbi_utils/rvbt/rvbt_hart.h>
 #include <sbi_utils/rvbt/rvbt_memory.h>
+#include <sbi_utils/rvbt/rvbt_profile.h>
+#include <sbi_utils/rvbt/rvbt_watchdog.h>
 
-struct rvbt_breakpoint_t rvbt_breakpoints[16];
+struct rvbt_breakpoint_t rvbt_breakpoints[RVBT_MAX_BREAKPOINTS];
+/* log2 of the physical window nearby instruction breakpoints share */
+static uint64_t rvbt_cluster_log2 = 6;
+/*
+ * Bumped on every change to the breakpoint table. Each hart caches the
+ * generation it last armed and re-arms lazily when they differ.
+ */
+static volatile unsigned long rvbt_bp_gen;
+/* Serialises harts adding or removing breakpoints */
+static spinlock_t rvbt_bp_lock = SPIN_LOCK_INITIALIZER;
+
+/*
+ * A hart-local breakpoint is only ever armed by the hart that set it,
+ * which re-arms on its own way out, so the other harts are left alone.
+ * Without a generation bump that hart would keep a deferral left over
+ * from the previous user of the index, so it is dropped here.
+ */
+void rvbt_breakpoint_changed(struct rvbt_breakpoint_t *bp)
+{
+	struct rvbt_hart_t *hart;
+
+	if (bp && bp->filter == FILTER_HART) {
+		hart = rvbt_hart();
+		if (hart && bp->space == current_hartid())
+			hart->pending &= ~(1UL << (bp - rvbt_breakpoints));
+		return;
+	}
+	smp_wmb();
+	rvbt_bp_gen++;
+}
+
+unsigned long rvbt_breakpoint_gen()
+{
+	return rvbt_bp_gen;
+}
+
+/* Called with rvbt_bp_lock held */
+static struct rvbt_breakpoint_t *rvbt_alloc_breakpoint()
+{
+	int i;
+
+	for (i = 0; i < RVBT_MAX_BREAKPOINTS; i++)
+		if (!rvbt_breakpoints[i].enabled)
+			return &rvbt_breakpoints[i];
+	return NULL;
+}
 
 int rvbt_set_data_point(uint64_t virt_addr, uint64_t log2size)
 {
-	int hartid		     = csr_read(CSR_MHARTID);
-	struct rvbt_breakpoint_t *bp = rvbt_breakpoints;
-	while (bp->enabled)
-		bp++;
+	struct rvbt_breakpoint_t *bp;
+
+	spin_lock(&rvbt_bp_lock);
+	bp = rvbt_alloc_breakpoint();
+	if (!bp) {
+		spin_unlock(&rvbt_bp_lock);
+		return SBI_ENOSPC;
+	}
 	bp->log2size		   = log2size;
+	bp->size		   = 1UL << log2size;
+	bp->access		   = RVBT_WATCH_READ | RVBT_WATCH_WRITE;
 	bp->type		   = DATA;
-	bp->addr[hartid].virt_addr = virt_addr;
+	bp->filter		   = FILTER_NONE;
+	bp->virt_addr		   = virt_addr;
+	bp->notified		   = 0;
 	bp->enabled		   = true;
-	return 0;
+	spin_unlock(&rvbt_bp_lock);
+	rvbt_breakpoint_changed(bp);
+	return bp - rvbt_breakpoints;
 }
 
-int rvbt_set_inst_point(uint64_t virt_addr)
+/*
+ * Byte-granular watchpoint on [virt_addr, virt_addr + size), armed as a
+ * TOR pair over the enclosing words. Loads are left alone by the PMP for
+ * write-only watchpoints, everything else in the region faults and is
+ * filtered by rvbt_watch_access().
+ */
+int rvbt_set_watch_point(uint64_t virt_addr, uint64_t size, uint8_t access)
+{
+	struct rvbt_breakpoint_t *bp;
+	if (!size || !access)
+		return SBI_EINVAL;
+	spin_lock(&rvbt_bp_lock);
+	bp = rvbt_alloc_breakpoint();
+	if (!bp) {
+		spin_unlock(&rvbt_bp_lock);
+		return SBI_ENOSPC;
+	}
+	bp->log2size = 2;
+	bp->size     = size;
+	bp->access   = access;
+	bp->type     = WATCH;
+	bp->filter   = FILTER_NONE;
+	bp->virt_addr = virt_addr;
+	bp->notified = 0;
+	bp->enabled = true;
+	spin_unlock(&rvbt_bp_lock);
+	rvbt_breakpoint_changed(bp);
+	return bp - rvbt_breakpoints;
+}
+
+/* Returns the breakpoint index, or an SBI error */
+int rvbt_set_inst_point_in(uint64_t virt_addr, enum rvbt_bp_filter_t filter,
+			   uint64_t space)
 {
-	int hartid		     = csr_read(CSR_MHARTID);
-	struct rvbt_breakpoint_t *bp = rvbt_breakpoints;
-	while (bp->enabled)
-		bp++;
+	struct rvbt_breakpoint_t *bp;
+
+	spin_lock(&rvbt_bp_lock);
+	bp = rvbt_alloc_breakpoint();
+	if (!bp) {
+		spin_unlock(&rvbt_bp_lock);
+		return SBI_ENOSPC;
+	}
 	bp->log2size		   = 2;
+	bp->size		   = 4;
+	bp->access		   = 0;
 	bp->type		   = INST;
-	bp->addr[hartid].virt_addr = virt_addr;
+	bp->filter		   = filter;
+	bp->space		   = space;
+	bp->virt_addr		   = virt_addr;
+	bp->notified		   = 0;
 	bp->enabled		   = true;
-	return 0;
+	spin_unlock(&rvbt_bp_lock);
+	rvbt_breakpoint_changed(bp);
+	return bp - rvbt_breakpoints;
 }
 
-int rvbt_update_breakpoint()
+void rvbt_clear_point(int idx)
+{
+	struct rvbt_breakpoint_t *bp;
+
+	if (idx < 0 || idx >= RVBT_MAX_BREAKPOINTS)
+		return;
+	bp = &rvbt_breakpoints[idx];
+	spin_lock(&rvbt_bp_lock);
+	bp->enabled = false;
+	spin_unlock(&rvbt_bp_lock);
+	rvbt_breakpoint_changed(bp);
+}
+
+int rvbt_set_inst_point(uint64_t virt_addr)
+{
+	return rvbt_set_inst_point_in(virt_addr, FILTER_NONE, 0);
+}
+
+/*
+ * A filtered breakpoint only lives in one address space (or on one
+ * hart), so it is neither translated nor armed anywhere else.
+ */
+static bool rvbt_in_space(struct rvbt_breakpoint_t *bp,
+			  struct riscv_satp_t satp)
 {
-	int i, pmp_cnt = 0, hartid;
+	switch (bp->filter) {
+	case FILTER_ASID:
+		return satp.asid == bp->space;
+	case FILTER_ROOT:
+		return satp.ppn == bp->space;
+	case FILTER_HART:
+		return current_hartid() == bp->space;
+	default:
+		return true;
+	}
+}
+
+/*
+ * Revisit this hart's deferred breakpoints after a TVM event. Whether a
+ * VA is mapped depends on the satp of the hart asking, so the deferred
+ * set lives in struct rvbt_hart_t and only its owner touches it. Only
+ * breakpoints whose page (and ASID) falls in the scope of the event are
+ * walked, so a page-sized sfence.vma elsewhere costs a compare per
+ * pending entry and nothing at all once none are pending. The caller
+ * re-arms this hart afterwards.
+ */
+void rvbt_resolve_pending(uint64_t virt_addr, uint64_t asid)
+{
+	int idx;
+	unsigned long bits;
 	uint64_t satp;
+	struct riscv_satp_t cur_space;
+	struct rvbt_breakpoint_t *bp;
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	if (!hart || !hart->pending)
+		return;
+	satp	  = csr_read(CSR_SATP);
+	cur_space = val_to_satp(satp);
+	for (bits = hart->pending; bits; bits &= bits - 1) {
+		idx = __ffs(bits);
+		bp  = &rvbt_breakpoints[idx];
+		if ((virt_addr != RVBT_SCOPE_ALL &&
+		     sv39_addr_to_ppn(virt_addr) !=
+			     sv39_addr_to_ppn(bp->virt_addr)) ||
+		    (asid != RVBT_SCOPE_ALL && bp->filter == FILTER_ASID &&
+		     bp->space != asid) ||
+		    !rvbt_in_space(bp, cur_space))
+			continue;
+		hart->phys_addr[idx] = rvbt_mmu_translate(bp->virt_addr, satp);
+		if (rvbt_in_phys_mem((void *)hart->phys_addr[idx]))
+			hart->pending &= ~(1UL << idx);
+	}
+}
+
+/*
+ * Deferral and arming are per hart and may repeat on every context
+ * switch; the user only hears about the first of each, from whichever
+ * hart gets there first.
+ */
+static void rvbt_notify(int idx, int what)
+{
+	struct rvbt_breakpoint_t *bp = &rvbt_breakpoints[idx];
+
+	if (atomic_raw_set_bit(what, &bp->notified) & BIT_MASK(what))
+		return;
+	if (what == RVBT_NOTIFIED_DEFERRED)
+		sbi_printf("[Raven]: Breakpoint %d at 0x%lx not mapped, deferred\n",
+			   idx, bp->virt_addr);
+	else
+		sbi_printf("[Raven]: Deferred breakpoint %d at 0x%lx armed on hart%d, phys: 0x%lx\n",
+			   idx, bp->virt_addr, current_hartid(),
+			   rvbt_hart()->phys_addr[idx]);
+}
+
+/*
+ * Instruction breakpoints falling in the same aligned physical window
+ * share one NAPOT region. A window holding a single breakpoint is still
+ * armed as an exact NA4 region so it never takes a false-positive trap.
+ */
+static int rvbt_alloc_slot(struct rvbt_slot_t *slots, int slot_cnt,
+			   struct rvbt_hart_t *hart, int idx)
+{
+	int n;
+	struct rvbt_breakpoint_t *bp = &rvbt_breakpoints[idx];
+	uint64_t phys_addr	     = hart->phys_addr[idx];
+	uint64_t base = phys_addr & ~((1UL << rvbt_cluster_log2) - 1);
+
+	if (bp->type == INST && rvbt_cluster_log2 > 2) {
+		for (n = 0; n < slot_cnt; n++) {
+			if (slots[n].type == INST && slots[n].base == base) {
+				slots[n].users++;
+				return slot_cnt;
+			}
+		}
+	}
+	if (slot_cnt + (bp->type == WATCH ? 2 : 1) > RVBT_PMP_SLOTS)
+		return -1;
+	slots[slot_cnt].type	  = bp->type;
+	slots[slot_cnt].base	  = base;
+	slots[slot_cnt].phys_addr = phys_addr;
+	slots[slot_cnt].log2size  = bp->log2size;
+	slots[slot_cnt].users	  = 1;
+	if (bp->type == WATCH) {
+		rvbt_watch_range(idx, hart, &slots[slot_cnt].base,
+				 &slots[slot_cnt].end);
+		slots[slot_cnt].prot = bp->access & RVBT_WATCH_READ ? PMP_X :
+								      PMP_R | PMP_X;
+		/* The TOR top entry, rvbt_arm_slot() programs both */
+		slots[slot_cnt + 1] = slots[slot_cnt];
+		return slot_cnt + 2;
+	}
+	return slot_cnt + 1;
+}
+
+static void rvbt_arm_slot(int n, struct rvbt_slot_t *slot)
+{
+	if (slot->type == WATCH)
+		rvbt_pmp_set_tor(n, slot->prot, slot->base, slot->end);
+	else if (slot->type == INST && slot->users > 1)
+		pmp_set(n, PMP_R | PMP_W, slot->base, rvbt_cluster_log2);
+	else if (slot->type == DATA && slot->log2size != 2)
+		pmp_set(n, PMP_A_NAPOT, slot->phys_addr, slot->log2size);
+	else
+		pmp_set(n, PMP_A_NA4 | PMP_R | PMP_W, slot->phys_addr,
+			slot->log2size);
+}
+
+int rvbt_update_breakpoint()
+{
+	int i, slot_cnt = 0, next;
+	uint64_t satp = csr_read(CSR_SATP);
+	struct riscv_satp_t cur_space = val_to_satp(satp);
+	struct rvbt_slot_t slots[RVBT_PMP_SLOTS];
 	struct rvbt_breakpoint_t *bp;
-	struct rvbt_addr_pair_t *bp_addr;
-	hartid = csr_read(CSR_MHARTID);
+	struct rvbt_hart_t *hart = rvbt_hart();
+	if (!hart)
+		return 0;
+	/*
+	 * PMP 0/1 hold the step, leave them and the generation alone until
+	 * it lands; the continue path re-arms with stepping cleared.
+	 */
+	if (hart->stepping)
+		return 0;
+	rvbt_cov_sync(hart);
+	rvbt_prof_sync(hart);
+	rvbt_wdog_sync(hart);
 	for (int idx = 0; idx < 4; idx++) {
 		pmp_set(idx, 0x0, 0x0, 0);
 	}
-	if (is_stepping[hartid])
-		return 0;
+	/* A changed table may reuse an index, translate everything again */
+	if (hart->gen != rvbt_bp_gen)
+		hart->pending = 0;
+	hart->gen = rvbt_bp_gen;
+	smp_rmb();
 	rvbt_clear_pmp();
-	for (i = 0; i < 16; i++) {
+	hart->stats.unarmed = 0;
+	hart->armed	    = 0;
+	for (i = 0; i < RVBT_MAX_BREAKPOINTS; i++) {
 		bp = &rvbt_breakpoints[i];
-		if (!bp->enabled)
+		hart->mem_reg[i] = NULL;
+		if (!bp->enabled || rvbt_bp_pending(hart, i) ||
+		    !rvbt_in_space(bp, cur_space))
 			continue;
-		satp	= csr_read(CSR_SATP);
-		bp_addr = &bp->addr[hartid];
-		bp_addr->phys_addr =
-			rvbt_mmu_translate(bp_addr->virt_addr, satp);
-		bp_addr->mem_reg = rvbt_in_phys_mem((void *)bp_addr->phys_addr);
-		if (bp_addr->mem_reg == NULL) {
+		hart->phys_addr[i] = rvbt_mmu_translate(bp->virt_addr, satp);
+		hart->mem_reg[i] =
+			rvbt_in_phys_mem((void *)hart->phys_addr[i]);
+		/* Not mapped in this space, wait for a TVM event to retry */
+		if (hart->mem_reg[i] == NULL) {
+			hart->pending |= 1UL << i;
+			rvbt_notify(i, RVBT_NOTIFIED_DEFERRED);
 			continue;
 		}
-		if (bp->type == DATA && bp->log2size != 2) {
-			pmp_set(pmp_cnt++, PMP_A_NAPOT, bp_addr->phys_addr,
-				bp->log2size);
+		next = rvbt_alloc_slot(slots, slot_cnt, hart, i);
+		if (next < 0) {
+			hart->stats.unarmed++;
 		} else {
-			pmp_set(pmp_cnt++, PMP_A_NA4 | PMP_R | PMP_W,
-				bp_addr->phys_addr, bp->log2size);
+			slot_cnt = next;
+			hart->armed |= 1UL << i;
+			if (bp->notified & BIT_MASK(RVBT_NOTIFIED_DEFERRED))
+				rvbt_notify(i, RVBT_NOTIFIED_ARMED);
 		}
 	}
+	for (i = 0; i < slot_cnt; i++) {
+		rvbt_arm_slot(i, &slots[i]);
+		if (slots[i].type == WATCH)
+			i++;
+	}
+	hart->stats.slots = slot_cnt;
 	return 0;
 }
+
+/*
+ * Called on an instruction fetch fault outside of stepping. Returns true
+ * when the fault hit a shared NAPOT window but none of the breakpoints
+ * in it, in which case the caller steps over it transparently.
+ */
+bool rvbt_breakpoint_false_hit(uint64_t virt_addr)
+{
+	int i;
+	bool in_window = false;
+	uint64_t satp = csr_read(CSR_SATP), phys_addr;
+	uint64_t mask = ~((1UL << rvbt_cluster_log2) - 1);
+	struct riscv_satp_t cur_space = val_to_satp(satp);
+	struct rvbt_breakpoint_t *bp;
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	phys_addr = rvbt_mmu_translate(virt_addr, satp);
+	for (i = 0; i < RVBT_MAX_BREAKPOINTS; i++) {
+		bp = &rvbt_breakpoints[i];
+		if (!bp->enabled || rvbt_bp_pending(hart, i) ||
+		    bp->type != INST ||
+		    !hart->mem_reg[i] || !rvbt_in_space(bp, cur_space))
+			continue;
+		if (hart->phys_addr[i] == phys_addr) {
+			hart->stats.hits++;
+			return false;
+		}
+		if ((hart->phys_addr[i] & mask) == (phys_addr & mask))
+			in_window = true;
+	}
+	if (in_window)
+		hart->stats.false_hits++;
+	return in_window;
+}
+
+void rvbt_set_cluster_window(uint64_t log2size)
+{
+	/* NAPOT regions are at least 8 bytes, anything smaller disables it */
+	rvbt_cluster_log2 = log2size < 3 ? 2 : log2size;
+	rvbt_breakpoint_changed(NULL);
+}
+
+/*
+ * Re-arm this hart if the table changed since it last did. A hart in the
+ * middle of a step catches up once the step has landed.
+ */
+void rvbt_sync_breakpoint()
+{
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	if (hart && !hart->stepping && hart->gen != rvbt_bp_gen)
+		rvbt_update_breakpoint();
+}
+
+void rvbt_breakpoint_info()
+{
+	int hartid			= csr_read(CSR_MHARTID);
+	struct rvbt_bp_stats_t *stats = rvbt_breakpoint_stats();
+
+	sbi_printf("[Raven]: hart%d PMP slots: %d/%d, unarmed: %lu, window: 2^%lu\n",
+		   hartid, stats->slots, RVBT_PMP_SLOTS, stats->unarmed,
+		   rvbt_cluster_log2);
+	sbi_printf("[Raven]: hart%d hits: %lu, false-positive traps: %lu\n",
+		   hartid, stats->hits, stats->false_hits);
+	sbi_printf("[Raven]: hart%d deferred (not mapped here): 0x%lx\n",
+		   hartid, rvbt_hart()->pending);
+	sbi_printf("[Raven]: hart%d watch hits: %lu, emulated in M-mode: %lu\n",
+		   hartid, stats->watch_hits, stats->watch_filtered);
+}
+
+struct rvbt_bp_stats_t *rvbt_breakpoint_stats()
+{
+	return &rvbt_hart()->stats;
+}
+
+/*
+ * Physical region a data breakpoint or watchpoint is armed over on the
+ * given hart. A watchpoint crossing into a non-contiguous physical page
+ * only covers its first page.
+ */
+bool rvbt_watch_range(int idx, struct rvbt_hart_t *hart, uint64_t *base,
+		      uint64_t *end)
+{
+	struct rvbt_breakpoint_t *bp = &rvbt_breakpoints[idx];
+	uint64_t phys_addr	     = hart->phys_addr[idx];
+
+	if (!hart->mem_reg[idx])
+		return false;
+	if (bp->type == DATA) {
+		*base = phys_addr & ~(bp->size - 1);
+		*end  = *base + bp->size;
+		return true;
+	}
+	*base = phys_addr & ~3UL;
+	*end  = phys_addr + bp->size;
+	if (*end > ((phys_addr | (PAGE_SIZE - 1)) + 1))
+		*end = (phys_addr | (PAGE_SIZE - 1)) + 1;
+	*end = (*end + 3) & ~3UL;
+	return true;
+}
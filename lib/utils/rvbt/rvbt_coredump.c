@@ -0,0 +1,193 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_string.h"
+#include "sbi_utils/rvbt/rvbt_coredump.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_serial.h"
+
+#define RVBT_SIGTRAP 5
+/* Pages of each region looked up to find where the kernel maps it */
+#define RVBT_CORE_PROBES 3
+
+static uint64_t rvbt_core_phys[RVBT_CORE_PROBES * 64];
+static uint64_t rvbt_core_virt[RVBT_CORE_PROBES * 64];
+
+/*
+ * Registers of hart i as far as we have them: our own trap frame, or the
+ * frame a hart parked with. Harts still running have nothing stable.
+ */
+static struct sbi_trap_regs *rvbt_core_regs(u32 i, struct sbi_trap_regs *regs)
+{
+	struct rvbt_hart_t *hart;
+
+	if (i == current_hartid())
+		return regs;
+	hart = rvbt_hart_of(i);
+	return hart ? hart->parked_regs : NULL;
+}
+
+static void rvbt_core_note(u32 hartid, const struct sbi_trap_regs *regs)
+{
+	struct rvbt_elf64_nhdr_t nhdr;
+	struct rvbt_prstatus_t prs;
+	const unsigned long *x = (const unsigned long *)regs;
+	int i;
+
+	sbi_memset(&nhdr, 0, sizeof(nhdr));
+	nhdr.n_namesz = 5;
+	nhdr.n_descsz = sizeof(prs);
+	nhdr.n_type   = RVBT_NT_PRSTATUS;
+	sbi_memcpy(nhdr.n_name, "CORE", 5);
+
+	sbi_memset(&prs, 0, sizeof(prs));
+	prs.si_signo  = RVBT_SIGTRAP;
+	prs.pr_cursig = RVBT_SIGTRAP;
+	/* gdb turns pids into threads, and pid 0 means none */
+	prs.pr_pid    = hartid + 1;
+	prs.pr_reg[0] = regs->mepc;
+	for (i = 1; i < 32; i++)
+		prs.pr_reg[i] = x[i];
+
+	rvbt_write_raw(&nhdr, sizeof(nhdr));
+	rvbt_write_raw(&prs, sizeof(prs));
+}
+
+/*
+ * The linear map keeps one offset over a whole region, but its first
+ * pages (the firmware) may be left out and single pages may also show up
+ * in vmalloc space. The offset most probes of the region agree on wins;
+ * a region the kernel does not map at all is placed at its physical
+ * address.
+ */
+static void rvbt_core_vaddrs(uint64_t region_mask, uint64_t *vaddr)
+{
+	int i, j, k, n = 0, votes, best;
+	uint64_t off[RVBT_CORE_PROBES];
+
+	for (i = 0; i < mem_reg_cnt; i++) {
+		if (!(region_mask & (1ULL << i)))
+			continue;
+		for (j = 0; j < RVBT_CORE_PROBES; j++)
+			rvbt_core_phys[n++] =
+				mem_regs[i].base +
+				((mem_regs[i].size - 1) * j /
+				 (RVBT_CORE_PROBES - 1) & ~0xfffUL);
+	}
+	rvbt_reverse_map_kernel(csr_read(CSR_SATP), rvbt_core_phys,
+				rvbt_core_virt, n);
+
+	for (i = 0, n = 0; i < mem_reg_cnt; i++) {
+		vaddr[i] = mem_regs[i].base;
+		if (!(region_mask & (1ULL << i)))
+			continue;
+		for (j = 0; j < RVBT_CORE_PROBES; j++)
+			off[j] = rvbt_core_virt[n + j] - rvbt_core_phys[n + j];
+		best = 0;
+		for (j = 0; j < RVBT_CORE_PROBES; j++) {
+			if (rvbt_core_virt[n + j] == (uint64_t)-1)
+				continue;
+			for (k = 0, votes = 0; k < RVBT_CORE_PROBES; k++)
+				votes += rvbt_core_virt[n + k] != (uint64_t)-1 &&
+					 off[k] == off[j];
+			if (votes > best) {
+				best	 = votes;
+				vaddr[i] = mem_regs[i].base + off[j];
+			}
+		}
+		n += RVBT_CORE_PROBES;
+	}
+}
+
+/*
+ * Stream an ELF64 core over the console: one NT_PRSTATUS per hart with
+ * registers, then the physical regions picked by region_mask as PT_LOAD
+ * segments, at their physical addresses and where the kernel's linear
+ * map puts them. Sizes are known up front, so nothing is buffered.
+ */
+int rvbt_coredump(struct sbi_trap_regs *regs, uint64_t region_mask)
+{
+	struct rvbt_elf64_ehdr_t ehdr;
+	struct rvbt_elf64_phdr_t phdr;
+	u32 i, nharts = 0, last = sbi_scratch_last_hartid();
+	uint64_t off, total, nloads = 0, vaddr[64];
+
+	if (!regs)
+		return SBI_EINVAL;
+	for (i = 0; i <= last; i++)
+		if (rvbt_core_regs(i, regs))
+			nharts++;
+	for (i = 0; i < mem_reg_cnt; i++)
+		if (region_mask & (1ULL << i))
+			nloads++;
+
+	sbi_memset(&ehdr, 0, sizeof(ehdr));
+	sbi_memcpy(ehdr.e_ident, "\177ELF", 4);
+	ehdr.e_ident[4]	  = 2; /* ELFCLASS64 */
+	ehdr.e_ident[5]	  = 1; /* ELFDATA2LSB */
+	ehdr.e_ident[6]	  = 1; /* EV_CURRENT */
+	ehdr.e_type	  = RVBT_ET_CORE;
+	ehdr.e_machine	  = RVBT_EM_RISCV;
+	ehdr.e_version	  = 1;
+	ehdr.e_phoff	  = sizeof(ehdr);
+	ehdr.e_ehsize	  = sizeof(ehdr);
+	ehdr.e_phentsize  = sizeof(phdr);
+	ehdr.e_phnum	  = 1 + nloads;
+
+	off   = sizeof(ehdr) + ehdr.e_phnum * sizeof(phdr);
+	total = off + nharts * (sizeof(struct rvbt_elf64_nhdr_t) +
+				sizeof(struct rvbt_prstatus_t));
+	for (i = 0; i < mem_reg_cnt; i++)
+		if (region_mask & (1ULL << i))
+			total += mem_regs[i].size;
+	rvbt_core_vaddrs(region_mask, vaddr);
+	sbi_printf("[Raven]: %lu bytes of core follow, %u harts, %lu regions\n",
+		   total, nharts, nloads);
+	rvbt_write_raw(&ehdr, sizeof(ehdr));
+
+	sbi_memset(&phdr, 0, sizeof(phdr));
+	phdr.p_type   = RVBT_PT_NOTE;
+	phdr.p_offset = off;
+	phdr.p_filesz = nharts * (sizeof(struct rvbt_elf64_nhdr_t) +
+				  sizeof(struct rvbt_prstatus_t));
+	rvbt_write_raw(&phdr, sizeof(phdr));
+	off += phdr.p_filesz;
+
+	for (i = 0; i < mem_reg_cnt; i++) {
+		if (!(region_mask & (1ULL << i)))
+			continue;
+		sbi_memset(&phdr, 0, sizeof(phdr));
+		phdr.p_type   = RVBT_PT_LOAD;
+		phdr.p_flags  = 7; /* RWX, we cannot tell */
+		phdr.p_offset = off;
+		phdr.p_vaddr  = vaddr[i];
+		phdr.p_paddr  = mem_regs[i].base;
+		phdr.p_filesz = mem_regs[i].size;
+		phdr.p_memsz  = mem_regs[i].size;
+		rvbt_write_raw(&phdr, sizeof(phdr));
+		off += mem_regs[i].size;
+	}
+
+	/* The stopping hart first, gdb picks the first thread as current */
+	rvbt_core_note(current_hartid(), regs);
+	for (i = 0; i <= last; i++)
+		if (i != current_hartid() && rvbt_core_regs(i, regs))
+			rvbt_core_note(i, rvbt_core_regs(i, regs));
+
+	for (i = 0; i < mem_reg_cnt; i++)
+		if (region_mask & (1ULL << i))
+			rvbt_write_raw((void *)mem_regs[i].base,
+				       mem_regs[i].size);
+	return 0;
+}
+
+void rvbt_coredump_regions(void)
+{
+	int i;
+
+	for (i = 0; i < mem_reg_cnt; i++)
+		sbi_printf("[Raven]: region %d: 0x%lx-0x%lx\n", i,
+			   mem_regs[i].base, mem_regs[i].base + mem_regs[i].size);
+}
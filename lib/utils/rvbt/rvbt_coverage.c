@@ -0,0 +1,232 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/riscv_atomic.h"
+#include "sbi/riscv_barrier.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_string.h"
+#include "sbi_utils/rvbt/mfmt.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_coverage.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_serial.h"
+
+#define RVBT_EBREAK   0x00100073
+#define RVBT_C_EBREAK 0x9002
+
+/* Sorted by virtual address so a hit is a binary search */
+static struct rvbt_cov_block_t rvbt_cov_blocks[RVBT_COV_BLOCKS];
+static int rvbt_cov_cnt;
+static unsigned long rvbt_cov_bitmap[BITS_TO_LONGS(RVBT_COV_BLOCKS)];
+static atomic_t rvbt_cov_left = ATOMIC_INITIALIZER(0);
+static volatile bool rvbt_cov_active;
+/* Bumped whenever the patched text or the ebreak delegation changes */
+static volatile unsigned long rvbt_cov_gen;
+
+int rvbt_cov_add(uint64_t virt_addr)
+{
+	int i;
+
+	if (rvbt_cov_active)
+		return SBI_EALREADY;
+	if (rvbt_cov_cnt == RVBT_COV_BLOCKS)
+		return SBI_ENOSPC;
+	for (i = rvbt_cov_cnt; i > 0; i--) {
+		if (rvbt_cov_blocks[i - 1].virt_addr == virt_addr)
+			return 0;
+		if (rvbt_cov_blocks[i - 1].virt_addr < virt_addr)
+			break;
+	}
+	sbi_memmove(&rvbt_cov_blocks[i + 1], &rvbt_cov_blocks[i],
+		    (rvbt_cov_cnt - i) * sizeof(rvbt_cov_blocks[0]));
+	sbi_memset(&rvbt_cov_blocks[i], 0, sizeof(rvbt_cov_blocks[0]));
+	rvbt_cov_blocks[i].virt_addr = virt_addr;
+	rvbt_cov_cnt++;
+	return 0;
+}
+
+/* Read block addresses from the console, one per line, up to "end" */
+int rvbt_cov_load(void)
+{
+	char *line;
+	int rc, n = 0;
+	uint64_t virt_addr;
+
+	sbi_printf("[Raven]: Send block addresses, \"end\" to finish\n");
+	while (true) {
+		line = rvbt_gets();
+		if (!sbi_strcmp(line, "end"))
+			break;
+		if (mfmt_scan(line, "%x", &virt_addr) != 1)
+			continue;
+		rc = rvbt_cov_add(virt_addr);
+		if (rc)
+			return rc;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Patch or restore a block with a single store, so a hart fetching it
+ * while the others run sees one instruction or the other, never half of
+ * each. A 32-bit instruction off a word boundary only exists with the C
+ * extension: it gets a c.ebreak over its first half and the second half
+ * is never touched.
+ */
+static void rvbt_cov_write(struct rvbt_cov_block_t *blk, bool restore)
+{
+	if (blk->len == 4 && !(blk->phys_addr & 3))
+		*(volatile uint32_t *)blk->phys_addr =
+			restore ? blk->orig[0] | (uint32_t)blk->orig[1] << 16 :
+				  RVBT_EBREAK;
+	else
+		*(volatile uint16_t *)blk->phys_addr =
+			restore ? blk->orig[0] : RVBT_C_EBREAK;
+}
+
+/*
+ * Patch every block with an ebreak, see rvbt_cov_write(). Kernel text is
+ * mapped the same in every address space, so one translation serves all
+ * harts; blocks that are not mapped yet are left out.
+ */
+int rvbt_cov_start(void)
+{
+	int i, armed = 0;
+	uint64_t satp = csr_read(CSR_SATP);
+	struct rvbt_cov_block_t *blk;
+
+	if (rvbt_cov_active || !rvbt_cov_cnt)
+		return SBI_EINVAL;
+	sbi_memset(rvbt_cov_bitmap, 0, sizeof(rvbt_cov_bitmap));
+	for (i = 0; i < rvbt_cov_cnt; i++) {
+		blk	       = &rvbt_cov_blocks[i];
+		blk->armed     = false;
+		blk->phys_addr = rvbt_mmu_translate(blk->virt_addr, satp);
+		if (!rvbt_in_phys_mem((void *)blk->phys_addr))
+			continue;
+		blk->orig[0] = *(uint16_t *)blk->phys_addr;
+		blk->len     = INSN_IS_16BIT(blk->orig[0]) ? 2 : 4;
+		if (blk->len == 4)
+			blk->orig[1] = *(uint16_t *)(blk->phys_addr + 2);
+		rvbt_cov_write(blk, false);
+		blk->armed = true;
+		armed++;
+	}
+	atomic_write(&rvbt_cov_left, armed);
+	rvbt_cov_active = armed > 0;
+	rvbt_cov_gen++;
+	rvbt_breakpoint_changed(NULL);
+	return armed;
+}
+
+/*
+ * Put back every block that never ran. Only called with the other harts
+ * stopped: until they re-arm they may still fetch the ebreak of a block
+ * that is no longer recognised here.
+ */
+void rvbt_cov_stop(void)
+{
+	int i;
+
+	for (i = 0; i < rvbt_cov_cnt; i++) {
+		if (!rvbt_cov_blocks[i].armed)
+			continue;
+		rvbt_cov_blocks[i].armed = false;
+		if (!(rvbt_cov_bitmap[BIT_WORD(i)] & BIT_MASK(i)))
+			rvbt_cov_write(&rvbt_cov_blocks[i], true);
+	}
+	atomic_write(&rvbt_cov_left, 0);
+	rvbt_cov_active = false;
+	rvbt_cov_gen++;
+	rvbt_breakpoint_changed(NULL);
+}
+
+/*
+ * Called while a hart re-arms. Breakpoints are delegated to S-mode by
+ * default; they are only taken in M-mode while blocks are patched, and
+ * every patch or restore is followed by a fence.i on each hart.
+ */
+void rvbt_cov_sync(struct rvbt_hart_t *hart)
+{
+	if (hart->cov_gen == rvbt_cov_gen)
+		return;
+	hart->cov_gen = rvbt_cov_gen;
+	if (rvbt_cov_active)
+		csr_clear(CSR_MEDELEG, 1UL << CAUSE_BREAKPOINT);
+	else
+		csr_set(CSR_MEDELEG, 1UL << CAUSE_BREAKPOINT);
+	RISCV_FENCE_I;
+}
+
+static int rvbt_cov_find(uint64_t virt_addr)
+{
+	int lo = 0, hi = rvbt_cov_cnt - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (rvbt_cov_blocks[mid].virt_addr == virt_addr)
+			return mid;
+		if (rvbt_cov_blocks[mid].virt_addr < virt_addr)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+/*
+ * ebreak handler. A first hit records the block and restores it, so
+ * each block costs one trap in total. A later hit is a hart still
+ * fetching the ebreak from a stale icache and only needs a fence.i.
+ * Anything else is the kernel's own ebreak and goes back to S-mode.
+ */
+bool rvbt_cov_hit(struct sbi_trap_regs *regs)
+{
+	int i = rvbt_cov_find(regs->mepc);
+	struct rvbt_cov_block_t *blk;
+
+	if (i < 0 || !rvbt_cov_blocks[i].armed)
+		return false;
+	blk = &rvbt_cov_blocks[i];
+	if (!(atomic_raw_set_bit(i, rvbt_cov_bitmap) & BIT_MASK(i))) {
+		rvbt_cov_write(blk, true);
+		/* The last block hands ebreak back to S-mode everywhere */
+		if (atomic_sub_return(&rvbt_cov_left, 1) == 0) {
+			rvbt_cov_active = false;
+			rvbt_cov_gen++;
+			rvbt_breakpoint_changed(NULL);
+		}
+	}
+	RISCV_FENCE_I;
+	return true;
+}
+
+void rvbt_cov_info(void)
+{
+	int i, hit = 0;
+
+	for (i = 0; i < rvbt_cov_cnt; i++)
+		if (rvbt_cov_bitmap[BIT_WORD(i)] & BIT_MASK(i))
+			hit++;
+	sbi_printf("[Raven]: coverage %s, %d/%d blocks hit, %ld armed\n",
+		   rvbt_cov_active ? "on" : "off", hit, rvbt_cov_cnt,
+		   atomic_read(&rvbt_cov_left));
+}
+
+/*
+ * Binary export: RVBT_COV_MAGIC, the block count as 32-bit little endian,
+ * then one bit per block in load order (sorted by address), LSB first.
+ */
+void rvbt_cov_dump(void)
+{
+	uint32_t cnt = rvbt_cov_cnt;
+	uint8_t hdr[sizeof(RVBT_COV_MAGIC) - 1 + 4];
+
+	sbi_memcpy(hdr, RVBT_COV_MAGIC, sizeof(RVBT_COV_MAGIC) - 1);
+	sbi_memcpy(hdr + sizeof(RVBT_COV_MAGIC) - 1, &cnt, 4);
+	sbi_printf("[Raven]: %lu bytes of coverage follow\n",
+		   sizeof(hdr) + (cnt + 7) / 8);
+	rvbt_write_raw(hdr, sizeof(hdr));
+	rvbt_write_raw(rvbt_cov_bitmap, (cnt + 7) / 8);
+}
@@ -0,0 +1,209 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/sbi_bitops.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi_utils/rvbt/rvbt_find.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+
+#define RVBT_PAGE_SIZE 4096UL
+
+static struct rvbt_find_t rvbt_find;
+
+static uint64_t rvbt_find_lanes(uint64_t v, unsigned long width)
+{
+	unsigned long i;
+
+	if (width < 8)
+		v &= (1ULL << (width * 8)) - 1;
+	for (i = width; i < 8; i *= 2)
+		v |= v << (i * 8);
+	return v;
+}
+
+static uint64_t rvbt_find_load(uint64_t pa, unsigned long width)
+{
+	switch (width) {
+	case 1:
+		return *(uint8_t *)pa;
+	case 2:
+		return *(uint16_t *)pa;
+	case 4:
+		return *(uint32_t *)pa;
+	default:
+		return *(uint64_t *)pa;
+	}
+}
+
+static void rvbt_find_record(uint64_t pa, uint64_t pa_base, uint64_t va_base)
+{
+	long n = atomic_add_return(&rvbt_find.hits, 1) - 1;
+
+	if (n >= RVBT_FIND_MAX)
+		return;
+	rvbt_find.phys[n] = pa;
+	rvbt_find.virt[n] =
+		va_base == (uint64_t)-1 ? va_base : va_base + pa - pa_base;
+}
+
+static bool rvbt_find_elem(uint64_t pa)
+{
+	struct rvbt_find_t *f = &rvbt_find;
+
+	/* Lane 0 of value and mask is the element itself */
+	return !((rvbt_find_load(pa, f->width) ^ f->value) & f->mask &
+		 (f->width < 8 ? (1ULL << (f->width * 8)) - 1 : ~0ULL));
+}
+
+/*
+ * Scan [pa, end) for naturally aligned elements. The middle runs a word at
+ * a time: after the xor and mask a matching lane is all zeroes, and
+ * ((x & ~top) + ~top) | x has the top bit of exactly those lanes clear.
+ */
+static void rvbt_find_range(uint64_t pa, uint64_t end, uint64_t va_base)
+{
+	struct rvbt_find_t *f = &rvbt_find;
+	uint64_t x, hits, low = ~f->top, pa_base = pa;
+	unsigned long w = f->width;
+
+	pa = (pa + w - 1) & ~(w - 1);
+	for (; pa + w <= end && (pa & 7); pa += w)
+		if (rvbt_find_elem(pa))
+			rvbt_find_record(pa, pa_base, va_base);
+	for (; pa + 8 <= end; pa += 8) {
+		x    = (*(uint64_t *)pa ^ f->value) & f->mask;
+		hits = ~(((x & low) + low) | x | low);
+		while (hits) {
+			rvbt_find_record(pa + __ffs(hits) / 8 / w * w, pa_base,
+					 va_base);
+			hits &= hits - 1;
+		}
+	}
+	for (; pa + w <= end; pa += w)
+		if (rvbt_find_elem(pa))
+			rvbt_find_record(pa, pa_base, va_base);
+}
+
+/* Everything but our own image, where the pattern always turns up */
+static void rvbt_find_clip(uint64_t pa, uint64_t end, uint64_t va_base)
+{
+	struct rvbt_find_t *f = &rvbt_find;
+	uint64_t mid;
+
+	if (pa < f->skip_base)
+		rvbt_find_range(pa, MIN(end, f->skip_base), va_base);
+	if (f->skip_end < end) {
+		mid = MAX(pa, f->skip_end);
+		rvbt_find_range(mid, end,
+				va_base == (uint64_t)-1 ? va_base :
+							  va_base + mid - pa);
+	}
+}
+
+/* Chunk n counts across all regions in order */
+static void rvbt_find_chunk(void *arg, unsigned long chunk)
+{
+	int i;
+	uint64_t n, base, end;
+
+	for (i = 0; i < mem_reg_cnt; i++) {
+		n = (mem_regs[i].size + RVBT_FIND_CHUNK - 1) / RVBT_FIND_CHUNK;
+		if (chunk < n)
+			break;
+		chunk -= n;
+	}
+	if (i == mem_reg_cnt)
+		return;
+	base = mem_regs[i].base + chunk * RVBT_FIND_CHUNK;
+	end  = MIN(base + RVBT_FIND_CHUNK, mem_regs[i].base + mem_regs[i].size);
+	rvbt_find_clip(base, end, -1);
+}
+
+static int rvbt_find_setup(uint64_t value, uint64_t mask, unsigned long width)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if (width != 1 && width != 2 && width != 4 && width != 8)
+		return SBI_EINVAL;
+	rvbt_find.width	    = width;
+	rvbt_find.mask	    = rvbt_find_lanes(mask, width);
+	rvbt_find.value	    = rvbt_find_lanes(value, width) & rvbt_find.mask;
+	rvbt_find.top	    = rvbt_find_lanes(1ULL << (width * 8 - 1), width);
+	rvbt_find.skip_base = scratch->fw_start;
+	rvbt_find.skip_end  = scratch->fw_start + scratch->fw_size;
+	atomic_write(&rvbt_find.hits, 0);
+	return 0;
+}
+
+static void rvbt_find_report(void)
+{
+	long i, j, hits = atomic_read(&rvbt_find.hits);
+	long n		 = MIN(hits, RVBT_FIND_MAX);
+	uint64_t pa, va;
+
+	/* Harts record in any order */
+	for (i = 1; i < n; i++) {
+		pa = rvbt_find.phys[i];
+		va = rvbt_find.virt[i];
+		for (j = i; j > 0 && rvbt_find.phys[j - 1] > pa; j--) {
+			rvbt_find.phys[j] = rvbt_find.phys[j - 1];
+			rvbt_find.virt[j] = rvbt_find.virt[j - 1];
+		}
+		rvbt_find.phys[j] = pa;
+		rvbt_find.virt[j] = va;
+	}
+	for (i = 0; i < n; i++) {
+		if (rvbt_find.virt[i] == (uint64_t)-1)
+			sbi_printf("[Raven]: 0x%lx unmapped\n", rvbt_find.phys[i]);
+		else
+			sbi_printf("[Raven]: 0x%lx at 0x%lx\n", rvbt_find.phys[i],
+				   rvbt_find.virt[i]);
+	}
+	sbi_printf("[Raven]: %ld matches", hits);
+	if (hits > n)
+		sbi_printf(", first %ld shown", n);
+	sbi_printf("\n");
+}
+
+/*
+ * Search all of physical RAM. Parked harts take 1MB chunks alongside us,
+ * and the matches are mapped back through the current page table in one
+ * walk.
+ */
+int rvbt_find_phys(uint64_t value, uint64_t mask, unsigned long width)
+{
+	int i;
+	unsigned long chunks = 0;
+
+	if (rvbt_find_setup(value, mask, width))
+		return SBI_EINVAL;
+	for (i = 0; i < mem_reg_cnt; i++)
+		chunks += (mem_regs[i].size + RVBT_FIND_CHUNK - 1) /
+			  RVBT_FIND_CHUNK;
+	rvbt_smp_parallel(rvbt_find_chunk, NULL, chunks);
+	rvbt_reverse_map(csr_read(CSR_SATP), rvbt_find.phys, rvbt_find.virt,
+			 MIN(atomic_read(&rvbt_find.hits), RVBT_FIND_MAX));
+	rvbt_find_report();
+	return 0;
+}
+
+/* Search [virt_addr, virt_addr + len) page by page in the current space */
+int rvbt_find_virt(uint64_t virt_addr, uint64_t len, uint64_t value,
+		   uint64_t mask, unsigned long width)
+{
+	uint64_t va, pa, seg, end = virt_addr + len;
+	uint64_t satp = csr_read(CSR_SATP);
+
+	if (rvbt_find_setup(value, mask, width))
+		return SBI_EINVAL;
+	for (va = virt_addr; va < end; va += seg) {
+		seg = MIN((va | (RVBT_PAGE_SIZE - 1)) + 1, end) - va;
+		pa  = rvbt_mmu_translate(va, satp);
+		if (rvbt_in_phys_mem((void *)pa) &&
+		    rvbt_in_phys_mem((void *)(pa + seg - 1)))
+			rvbt_find_clip(pa, pa + seg, va);
+	}
+	rvbt_find_report();
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/riscv_barrier.h"
+#include "sbi/sbi_bitops.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_timer.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_ftrace.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_init.h"
+
+static struct rvbt_ftrace_fn_t rvbt_ftrace_fns[RVBT_FTRACE_FUNCS];
+static int rvbt_ftrace_cnt;
+static unsigned long rvbt_ftrace_off;
+
+static struct rvbt_ftrace_stack_t *rvbt_ftrace_stack(void)
+{
+	if (!rvbt_ftrace_off)
+		return NULL;
+	return sbi_scratch_thishart_offset_ptr(rvbt_ftrace_off);
+}
+
+int rvbt_ftrace_init(void)
+{
+	rvbt_ftrace_off =
+		sbi_scratch_alloc_offset(sizeof(struct rvbt_ftrace_stack_t));
+	if (!rvbt_ftrace_off)
+		return SBI_ENOMEM;
+	return 0;
+}
+
+/* Only called from the prompt, which the other harts never run at once */
+int rvbt_ftrace_add(uint64_t entry)
+{
+	int bp;
+	struct rvbt_ftrace_fn_t *fn;
+
+	if (!rvbt_ftrace_off || rvbt_ftrace_cnt == RVBT_FTRACE_FUNCS)
+		return SBI_ENOSPC;
+	bp = rvbt_set_inst_point(entry);
+	if (bp < 0)
+		return bp;
+	fn	  = &rvbt_ftrace_fns[rvbt_ftrace_cnt];
+	fn->entry = entry;
+	fn->bp	  = bp;
+	smp_wmb();
+	rvbt_ftrace_cnt++;
+	return 0;
+}
+
+/*
+ * Return breakpoints are one-shot and armed on this hart only. Recursive
+ * calls through the same call site share the breakpoint of the outer
+ * frame; it goes away with the last frame using it. A new one is armed
+ * right away: one that got no PMP entry (or is not mapped) never fires,
+ * so nothing would ever free it.
+ */
+static int rvbt_ftrace_ret_point(struct rvbt_ftrace_stack_t *st, uint64_t ret)
+{
+	int i, bp;
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	for (i = 0; i < st->depth; i++)
+		if (st->frames[i].ret == ret)
+			return st->frames[i].bp;
+	bp = rvbt_set_inst_point_in(ret, FILTER_HART, current_hartid());
+	if (bp < 0)
+		return bp;
+	rvbt_update_breakpoint();
+	if (hart && rvbt_bp_armed(hart, bp))
+		return bp;
+	rvbt_clear_point(bp);
+	return SBI_ENOSPC;
+}
+
+static void rvbt_ftrace_pop(struct rvbt_ftrace_stack_t *st)
+{
+	int i, bp = st->frames[--st->depth].bp;
+
+	for (i = 0; i < st->depth; i++)
+		if (st->frames[i].bp == bp)
+			return;
+	rvbt_clear_point(bp);
+}
+
+static void rvbt_ftrace_record(struct rvbt_ftrace_fn_t *fn, uint64_t ticks)
+{
+	int n = ticks ? __fls(ticks) : 0;
+
+	if (n >= RVBT_FTRACE_BUCKETS)
+		n = RVBT_FTRACE_BUCKETS - 1;
+	atomic_add_return(&fn->hist[n], 1);
+	atomic_add_return(&fn->calls, 1);
+}
+
+/* Whether the hit is on a return breakpoint of one of the frames */
+static bool rvbt_ftrace_owns(struct rvbt_ftrace_stack_t *st, uint64_t pc)
+{
+	int i;
+
+	for (i = 0; i < st->depth; i++)
+		if (rvbt_breakpoints[st->frames[i].bp].virt_addr == pc)
+			return true;
+	return false;
+}
+
+/*
+ * Called for a breakpoint hit before the prompt. A return is matched on
+ * both the address and the stack pointer, which is back to its value at
+ * entry once the callee returns, so recursive calls through one call site
+ * pop in order. Frames above the match never returned normally (longjmp,
+ * exceptions) and are discarded without a sample. A hit on one of our
+ * return breakpoints without a matching sp is still ours: the frames the
+ * stack has already unwound past are dropped and the hart moves on.
+ */
+bool rvbt_ftrace_hit(struct sbi_trap_regs *regs)
+{
+	int i, bp;
+	uint64_t now = sbi_timer_value();
+	struct rvbt_ftrace_stack_t *st = rvbt_ftrace_stack();
+	struct rvbt_ftrace_frame_t *frame;
+	struct rvbt_ftrace_fn_t *fn;
+
+	if (!st || !rvbt_ftrace_cnt)
+		return false;
+	for (i = st->depth - 1; i >= 0; i--) {
+		frame = &st->frames[i];
+		if (frame->ret != regs->mepc || frame->sp != regs->sp)
+			continue;
+		rvbt_ftrace_record(&rvbt_ftrace_fns[frame->fn],
+				   now - frame->start);
+		while (st->depth > i)
+			rvbt_ftrace_pop(st);
+		rvbt_resume(regs);
+		return true;
+	}
+	if (rvbt_ftrace_owns(st, regs->mepc)) {
+		while (st->depth && st->frames[st->depth - 1].sp < regs->sp)
+			rvbt_ftrace_pop(st);
+		rvbt_resume(regs);
+		return true;
+	}
+
+	for (i = 0; i < rvbt_ftrace_cnt; i++)
+		if (rvbt_ftrace_fns[i].entry == regs->mepc)
+			break;
+	if (i == rvbt_ftrace_cnt)
+		return false;
+	fn = &rvbt_ftrace_fns[i];
+	bp = st->depth < RVBT_FTRACE_DEPTH ?
+		     rvbt_ftrace_ret_point(st, regs->ra) : SBI_ENOSPC;
+	if (bp < 0) {
+		atomic_add_return(&fn->dropped, 1);
+	} else {
+		frame	     = &st->frames[st->depth++];
+		frame->ret   = regs->ra;
+		frame->sp    = regs->sp;
+		frame->start = now;
+		frame->fn    = i;
+		frame->bp    = bp;
+	}
+	rvbt_resume(regs);
+	return true;
+}
+
+void rvbt_ftrace_show(void)
+{
+	int i, n;
+	long cnt;
+	struct rvbt_ftrace_fn_t *fn;
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+	uint64_t freq = timer ? timer->timer_freq : 0;
+
+	if (!rvbt_ftrace_cnt)
+		sbi_printf("[Raven]: No function traced\n");
+	for (i = 0; i < rvbt_ftrace_cnt; i++) {
+		fn = &rvbt_ftrace_fns[i];
+		sbi_printf("[Raven]: 0x%lx: %ld calls, %ld untraced\n",
+			   fn->entry, atomic_read(&fn->calls),
+			   atomic_read(&fn->dropped));
+		for (n = 0; n < RVBT_FTRACE_BUCKETS; n++) {
+			cnt = atomic_read(&fn->hist[n]);
+			if (!cnt)
+				continue;
+			sbi_printf("[Raven]:   >= %lu ticks (%lu ns): %ld\n",
+				   1UL << n,
+				   freq ? (1UL << n) * 1000000000UL / freq : 0,
+				   cnt);
+		}
+	}
+}
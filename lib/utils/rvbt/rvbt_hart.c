@@ -0,0 +1,34 @@
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+
+static unsigned long rvbt_hart_off;
+
+/*
+ * One rvbt_hart_t per hart the platform (from the FDT on generic) brought
+ * up, so sparse or large hart ids cost nothing extra. The allocator zeroes
+ * it on every hart.
+ */
+int rvbt_hart_init(void)
+{
+	rvbt_hart_off = sbi_scratch_alloc_offset(sizeof(struct rvbt_hart_t));
+	if (!rvbt_hart_off)
+		return SBI_ENOMEM;
+	return 0;
+}
+
+struct rvbt_hart_t *rvbt_hart(void)
+{
+	if (!rvbt_hart_off)
+		return NULL;
+	return sbi_scratch_thishart_offset_ptr(rvbt_hart_off);
+}
+
+struct rvbt_hart_t *rvbt_hart_of(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!rvbt_hart_off || !scratch)
+		return NULL;
+	return sbi_scratch_offset_ptr(scratch, rvbt_hart_off);
+}
@@ -1,44 +1,197 @@
 #include "sbi/riscv_asm.h"
 #include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
 #include "sbi/sbi_ipi.h"
 #include "sbi/sbi_string.h"
 #include "sbi_utils/rvbt/rvbt_memory.h"
 #include "sbi_utils/rvbt/mfmt.h"
 #include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_coredump.h"
+#include "sbi_utils/rvbt/rvbt_coverage.h"
+#include "sbi_utils/rvbt/rvbt_find.h"
+#include "sbi_utils/rvbt/rvbt_ftrace.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_init.h"
+#include "sbi_utils/rvbt/rvbt_profile.h"
 #include "sbi_utils/rvbt/rvbt_serial.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+#include "sbi_utils/rvbt/rvbt_snap.h"
 #include "sbi_utils/rvbt/rvbt_stepping.h"
+#include "sbi_utils/rvbt/rvbt_timer.h"
+#include "sbi_utils/rvbt/rvbt_trace.h"
+#include "sbi_utils/rvbt/rvbt_watchdog.h"
 #include "sbi/sbi_ipi.h"
 #include "sbi/sbi_trap.h"
-static bool is_continuing[16];
+
+/* Step over the trapping instruction and re-arm every breakpoint */
+void rvbt_resume(struct sbi_trap_regs *regs)
+{
+	rvbt_stepping(regs);
+	rvbt_hart()->continuing = true;
+	rvbt_update_breakpoint();
+}
 
 void rvbt_init(void *fdt)
 {
+	if (rvbt_hart_init()) {
+		sbi_printf("[Raven]: No scratch space for per-hart state\n");
+		return;
+	}
 	rvbt_detect_phys_mem(fdt);
   rvbt_set_inst_point(0x80202000);
   rvbt_update_breakpoint();
 	rvbt_serial_init();
+	rvbt_smp_init();
+	if (rvbt_trace_init())
+		sbi_printf("[Raven]: No scratch space for the branch ring\n");
+	if (rvbt_ftrace_init())
+		sbi_printf("[Raven]: No scratch space for ftrace frames\n");
+	if (rvbt_prof_init())
+		sbi_printf("[Raven]: No scratch space for the profiler\n");
+	rvbt_wdog_init();
+	rvbt_timer_init();
+}
+
+static const char *const rvbt_reg_names[32] = {
+	"zero", "ra", "sp", "gp", "tp",	 "t0",	"t1", "t2",
+	"s0",	"s1", "a0", "a1", "a2",	 "a3",	"a4", "a5",
+	"a6",	"a7", "s2", "s3", "s4",	 "s5",	"s6", "s7",
+	"s8",	"s9", "s10", "s11", "t3", "t4", "t5", "t6",
+};
+
+/* struct sbi_trap_regs starts with x0..x31 in order */
+void rvbt_dump_regs(const struct sbi_trap_regs *regs)
+{
+	int i;
+	const unsigned long *x = (const unsigned long *)regs;
+
+	sbi_printf("[Raven]: mepc: 0x%lx mstatus: 0x%lx\n", regs->mepc,
+		   regs->mstatus);
+	for (i = 0; i < 32; i += 2)
+		sbi_printf("[Raven]: %-4s: 0x%016lx %-4s: 0x%016lx\n",
+			   rvbt_reg_names[i], x[i], rvbt_reg_names[i + 1],
+			   x[i + 1]);
 }
 
 int rvbt_loop(struct sbi_trap_regs *regs)
 {
-	char cmd[20];
-  char param[20];
-	int hartid = csr_read(CSR_MHARTID);
-	char *input;
-	uint64_t virt_addr = 0, phys_addr = 0;
-	uint64_t satp_val = csr_read(CSR_SATP);
-	if (is_continuing[hartid]) {
-		is_continuing[hartid] = false;
-		is_stepping[hartid]   = false;
+	struct rvbt_hart_t *hart = rvbt_hart();
+	if (!hart)
+		return SBI_ENOMEM;
+	if (hart->continuing) {
+		hart->continuing = false;
+		hart->stepping	 = false;
 		rvbt_update_breakpoint();
 		return 0;
 	}
+	if (rvbt_trace_active())
+		return rvbt_trace_step(regs);
+	if (!hart->stepping && rvbt_breakpoint_false_hit(regs->mepc)) {
+		rvbt_resume(regs);
+		return 0;
+	}
+	if (!hart->stepping && rvbt_ftrace_hit(regs))
+		return 0;
+	return rvbt_prompt(regs);
+}
+
+static void rvbt_cmd_cov(const char *sub)
+{
+	int rc = 0;
+
+	if (!sbi_strcmp(sub, "load")) {
+		rc = rvbt_cov_load();
+	} else if (!sbi_strcmp(sub, "start") || !sbi_strcmp(sub, "stop")) {
+		/*
+		 * Nobody may run into a patched block while it still delegates
+		 * ebreak, nor fetch the stale ebreak of a restored block from
+		 * its icache once stop no longer recognises it.
+		 */
+		if (!rvbt_smp_world_stopped() && sbi_scratch_last_hartid())
+			sbi_printf("[Raven]: Coverage %ss in all-stop mode only\n",
+				   sub);
+		else if (!sbi_strcmp(sub, "start"))
+			rc = rvbt_cov_start();
+		else
+			rvbt_cov_stop();
+	} else if (!sbi_strcmp(sub, "dump")) {
+		rvbt_cov_dump();
+		return;
+	}
+	if (rc < 0)
+		sbi_printf("[Raven]: coverage %s failed: %d\n", sub, rc);
+	/* Delegation and fence.i for this hart, the others do it on release */
+	rvbt_update_breakpoint();
+	rvbt_cov_info();
+}
+
+/*
+ * find <value> [mask] [width]: all of physical RAM
+ * findv <va> <len> <value> [mask] [width]: a range of the current space
+ */
+static void rvbt_cmd_find(const char *input, bool virt)
+{
+	char cmd[20];
+	uint64_t va = 0, len = 0, value = 0, mask = -1, width = 8;
+	int rc;
+
+	if (virt) {
+		if (mfmt_scan(input, "%s %x %u %x %x %u", cmd, &va, &len, &value,
+			      &mask, &width) < 4)
+			rc = SBI_EINVAL;
+		else
+			rc = rvbt_find_virt(va, len, value, mask, width);
+	} else if (mfmt_scan(input, "%s %x %x %u", cmd, &value, &mask,
+			     &width) < 2) {
+		rc = SBI_EINVAL;
+	} else {
+		rc = rvbt_find_phys(value, mask, width);
+	}
+	if (rc)
+		sbi_printf("[Raven]: Usage: find <value> [mask] [width], "
+			   "findv <va> <len> <value> [mask] [width]\n");
+}
+
+/* prof start <hz> [depth] | prof stop | prof [top <n>] */
+static void rvbt_cmd_prof(const char *input)
+{
+	char cmd[20], sub[20], arg1[20], arg2[20];
+	uint64_t hz = 0, depth = 0, n = 10;
+
+	sub[0] = arg1[0] = arg2[0] = '\0';
+	mfmt_scan(input, "%s %s %s %s", cmd, sub, arg1, arg2);
+	if (!sbi_strcmp(sub, "start")) {
+		mfmt_scan(arg1, "%u", &hz);
+		mfmt_scan(arg2, "%u", &depth);
+		if (rvbt_prof_start(hz, depth))
+			sbi_printf("[Raven]: Usage: prof start <hz> [depth]\n");
+		rvbt_update_breakpoint();
+		return;
+	}
+	if (!sbi_strcmp(sub, "stop")) {
+		rvbt_prof_stop();
+		rvbt_update_breakpoint();
+	}
+	mfmt_scan(arg1, "%u", &n);
+	rvbt_prof_top(n);
+}
+
+static int rvbt_cmd_loop(struct sbi_trap_regs *regs)
+{
+	char cmd[20];
+	char param[20];
+	char opt[20];
+	char *input;
+	uint64_t virt_addr = 0, phys_addr = 0, size, space;
+	uint64_t satp_val = csr_read(CSR_SATP);
+	struct riscv_satp_t satp = val_to_satp(satp_val);
 	sbi_printf("At 0x%lx 0x%lx\n", regs->mepc,
 		   rvbt_mmu_translate(regs->mepc, satp_val));
 	while (true) {
 		sbi_printf("[Raven]: Input command:");
 		input = rvbt_gets();
-		mfmt_scan(input, "%s %s", cmd, param);
+		cmd[0] = param[0] = opt[0] = '\0';
+		mfmt_scan(input, "%s %s %s", cmd, param, opt);
 		if (!sbi_strcmp(cmd, "s")) {
 			if (rvbt_stepping(regs))
 				sbi_printf(
@@ -80,10 +233,100 @@ int rvbt_loop(struct sbi_trap_regs *regs)
 		  mfmt_scan(param, "%x", &virt_addr);
 			rvbt_set_inst_point(virt_addr);
 			rvbt_update_breakpoint();
-		} else if (!sbi_strcmp(cmd, "c")) {
-			rvbt_stepping(regs);
-			is_continuing[hartid] = true;
+		} else if (!sbi_strcmp(cmd, "ba") || !sbi_strcmp(cmd, "bt")) {
+			/* Default to the address space we stopped in */
+			space = cmd[1] == 'a' ? satp.asid : satp.ppn;
+			mfmt_scan(param, "%x", &virt_addr);
+			mfmt_scan(opt, "%x", &space);
+			rvbt_set_inst_point_in(virt_addr,
+					       cmd[1] == 'a' ? FILTER_ASID :
+							       FILTER_ROOT,
+					       space);
+			rvbt_update_breakpoint();
+		} else if (!sbi_strcmp(cmd, "ww") || !sbi_strcmp(cmd, "wr") ||
+			   !sbi_strcmp(cmd, "wa")) {
+			size = 1;
+			mfmt_scan(param, "%x", &virt_addr);
+			mfmt_scan(opt, "%u", &size);
+			rvbt_set_watch_point(virt_addr, size,
+					     cmd[1] == 'w' ? RVBT_WATCH_WRITE :
+					     cmd[1] == 'r' ? RVBT_WATCH_READ :
+							     RVBT_WATCH_READ |
+								     RVBT_WATCH_WRITE);
 			rvbt_update_breakpoint();
+		} else if (!sbi_strcmp(cmd, "bw")) {
+			if (mfmt_scan(param, "%u", &space) == 1) {
+				rvbt_set_cluster_window(space);
+				rvbt_update_breakpoint();
+			}
+			rvbt_breakpoint_info();
+		} else if (!sbi_strcmp(cmd, "info")) {
+			rvbt_breakpoint_info();
+		} else if (!sbi_strcmp(cmd, "mode")) {
+			if (!sbi_strcmp(param, "all"))
+				rvbt_smp_set_mode(ALL_STOP);
+			else if (!sbi_strcmp(param, "non"))
+				rvbt_smp_set_mode(NON_STOP);
+			rvbt_smp_info();
+		} else if (!sbi_strcmp(cmd, "harts")) {
+			rvbt_smp_info();
+		} else if (!sbi_strcmp(cmd, "trace")) {
+			if (mfmt_scan(param, "%u", &size) != 1 || !size)
+				sbi_printf("[Raven]: Usage: trace <insns>\n");
+			else if (!rvbt_trace_start(regs, size))
+				return 0;
+		} else if (!sbi_strcmp(cmd, "ftrace")) {
+			if (mfmt_scan(param, "%x", &virt_addr) == 1) {
+				if (rvbt_ftrace_add(virt_addr))
+					sbi_printf("[Raven]: Cannot trace 0x%lx\n",
+						   virt_addr);
+				rvbt_update_breakpoint();
+			} else {
+				rvbt_ftrace_show();
+			}
+		} else if (!sbi_strcmp(cmd, "cov")) {
+			rvbt_cmd_cov(param);
+		} else if (!sbi_strcmp(cmd, "prof")) {
+			rvbt_cmd_prof(input);
+		} else if (!sbi_strcmp(cmd, "regs")) {
+			rvbt_dump_regs(regs);
+		} else if (!sbi_strcmp(cmd, "wdog")) {
+			if (!sbi_strcmp(param, "off"))
+				rvbt_wdog_stop();
+			else if (mfmt_scan(param, "%u", &size) == 1 &&
+				 rvbt_wdog_start(size, sbi_strcmp(opt, "dump")))
+				sbi_printf("[Raven]: Usage: wdog <ms> [dump]|off\n");
+			rvbt_update_breakpoint();
+			rvbt_wdog_info();
+		} else if (!sbi_strcmp(cmd, "find") ||
+			   !sbi_strcmp(cmd, "findv")) {
+			rvbt_cmd_find(input, cmd[4] == 'v');
+		} else if (!sbi_strcmp(cmd, "snap")) {
+			/* snap [<pa> <len>], all of RAM by default */
+			phys_addr = size = 0;
+			mfmt_scan(param, "%x", &phys_addr);
+			mfmt_scan(opt, "%u", &size);
+			if (rvbt_snap(phys_addr, size))
+				sbi_printf("[Raven]: Usage: snap [<pa> <len>]\n");
+		} else if (!sbi_strcmp(cmd, "diff")) {
+			/* diff [<pa>], words of a block the last diff kept */
+			if (mfmt_scan(param, "%x", &phys_addr) != 1)
+				rvbt_snap_diff();
+			else if (rvbt_snap_words(phys_addr))
+				sbi_printf("[Raven]: No kept block at 0x%lx\n",
+					   phys_addr);
+		} else if (!sbi_strcmp(cmd, "coredump")) {
+			/* Bit n of the mask picks region n, 0 dumps registers only */
+			if (mfmt_scan(param, "%x", &space) == 1) {
+				rvbt_coredump(regs, space);
+			} else {
+				rvbt_coredump_regions();
+				sbi_printf("[Raven]: Usage: coredump <region mask>\n");
+			}
+		} else if (!sbi_strcmp(cmd, "lbr")) {
+			rvbt_trace_dump();
+		} else if (!sbi_strcmp(cmd, "c")) {
+			rvbt_resume(regs);
 			return 0;
 		} else {
 			sbi_printf(
@@ -91,3 +334,14 @@ int rvbt_loop(struct sbi_trap_regs *regs)
 		}
 	}
 }
+
+/* Hold the other harts, as the mode asks, while we sit at the prompt */
+int rvbt_prompt(struct sbi_trap_regs *regs)
+{
+	int rc;
+
+	rvbt_smp_stop(regs);
+	rc = rvbt_cmd_loop(regs);
+	rvbt_smp_release();
+	return rc;
+}
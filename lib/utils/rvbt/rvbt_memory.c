@@ -188,16 +188,137 @@ uint64_t rvbt_mmu_translate(uint64_t virt_addr, uint64_t satp_val)
 	return rvbt_pageroot_translate(virt_addr, satp.ppn);
 }
 
-void rvbt_clear_pmp() {
+void rvbt_clear_pmp_slot(int n)
+{
 	int pmpcfg_csr, pmpcfg_shift, pmpaddr_csr;
-  unsigned long cfgmask, pmpcfg;
-  for (int n = 0; n < 4; n++) {
-    pmpcfg_csr   = (CSR_PMPCFG0 + (n >> 2)) & ~1;
-	  pmpcfg_shift = (n & 7) << 3;
-	  pmpaddr_csr = CSR_PMPADDR0 + n;
-	  cfgmask = ~(0xffUL << pmpcfg_shift);
-    pmpcfg = (csr_read_num(pmpcfg_csr) & cfgmask);
-    csr_write_num(pmpaddr_csr, 0);
-	  csr_write_num(pmpcfg_csr, pmpcfg);
-  }
+	unsigned long cfgmask, pmpcfg;
+
+	pmpcfg_csr   = (CSR_PMPCFG0 + (n >> 2)) & ~1;
+	pmpcfg_shift = (n & 7) << 3;
+	pmpaddr_csr  = CSR_PMPADDR0 + n;
+	cfgmask	     = ~(0xffUL << pmpcfg_shift);
+	pmpcfg	     = (csr_read_num(pmpcfg_csr) & cfgmask);
+	csr_write_num(pmpaddr_csr, 0);
+	csr_write_num(pmpcfg_csr, pmpcfg);
+}
+
+void rvbt_clear_pmp() {
+  for (int n = 0; n < RVBT_PMP_SLOTS; n++)
+    rvbt_clear_pmp_slot(n);
+}
+
+/*
+ * Arm a TOR region [base, end) on entries n and n + 1. Entry n only
+ * provides the bottom address and stays OFF. pmp_set() cannot encode
+ * TOR, hence the raw CSR accesses.
+ */
+void rvbt_pmp_set_tor(int n, unsigned long prot, uint64_t base, uint64_t end)
+{
+	int pmpcfg_csr, pmpcfg_shift;
+	unsigned long cfgmask, pmpcfg;
+
+	rvbt_clear_pmp_slot(n);
+	csr_write_num(CSR_PMPADDR0 + n, base >> PMP_SHIFT);
+	csr_write_num(CSR_PMPADDR0 + n + 1, end >> PMP_SHIFT);
+	pmpcfg_csr   = (CSR_PMPCFG0 + ((n + 1) >> 2)) & ~1;
+	pmpcfg_shift = ((n + 1) & 7) << 3;
+	cfgmask	     = ~(0xffUL << pmpcfg_shift);
+	pmpcfg	     = (csr_read_num(pmpcfg_csr) & cfgmask);
+	pmpcfg |= (((prot | PMP_A_TOR) << pmpcfg_shift) & ~cfgmask);
+	csr_write_num(pmpcfg_csr, pmpcfg);
+}
+
+/*
+ * Follow a frame-pointer chain through the given address space. A frame
+ * record sits right below the frame pointer: the caller's fp at fp - 16
+ * and the return address at fp - 8. Returns the number of return
+ * addresses stored in ret.
+ */
+int rvbt_unwind(uint64_t fp, uint64_t satp, uint64_t *ret, int max)
+{
+	int n = 0;
+	uint64_t rec, next;
+
+	while (n < max && fp && !(fp & 7)) {
+		rec = rvbt_mmu_translate(fp - 16, satp);
+		if (!rvbt_in_phys_mem((void *)rec) ||
+		    !rvbt_in_phys_mem((void *)(rec + 15)))
+			break;
+		next	 = ((uint64_t *)rec)[0];
+		ret[n++] = ((uint64_t *)rec)[1];
+		/* Frames only grow towards higher addresses as we unwind */
+		if (next <= fp)
+			break;
+		fp = next;
+	}
+	return n;
+}
+
+static uint64_t sv39_sign_extend(uint64_t va)
+{
+	return (va & (1ULL << 38)) ? va | ~((1ULL << 39) - 1) : va;
+}
+
+static void rvbt_rmap_walk(struct sv39_pte_t *table, int level, int first,
+			   uint64_t va_base, const uint64_t *phys,
+			   uint64_t *virt, int n)
+{
+	int i, j;
+	uint64_t va, pa, size = 1ULL << (12 + level * 9);
+	struct sv39_pte_t pte;
+	struct sv39_pte_t *next;
+
+	for (i = first; i < 512; i++) {
+		pte = table[i];
+		if (!pte.valid)
+			continue;
+		va = va_base + i * size;
+		if (pte.readable || pte.executable) {
+			pa = sv39_ppn_to_addr(pte.ppn) & ~(size - 1);
+			for (j = 0; j < n; j++)
+				if (virt[j] == (uint64_t)-1 && phys[j] - pa < size)
+					virt[j] = sv39_sign_extend(va + phys[j] - pa);
+			continue;
+		}
+		next = (struct sv39_pte_t *)sv39_ppn_to_addr(pte.ppn);
+		if (level && rvbt_in_phys_mem(next))
+			rvbt_rmap_walk(next, level - 1, 0, va, phys, virt, n);
+	}
+}
+
+/*
+ * Find a virtual address for each of n physical addresses with a single
+ * walk of the page table. Addresses nothing maps stay at -1; with several
+ * mappings the first one in table order wins.
+ */
+static void rvbt_reverse_map_from(uint64_t satp_val, int first,
+				  const uint64_t *phys, uint64_t *virt, int n)
+{
+	int j;
+	struct riscv_satp_t satp = val_to_satp(satp_val);
+	struct sv39_pte_t *root;
+
+	for (j = 0; j < n; j++)
+		virt[j] = satp.mode == SATP_MODE_OFF ? phys[j] : (uint64_t)-1;
+	if (satp.mode != SATP_MODE_SV39)
+		return;
+	root = (struct sv39_pte_t *)sv39_ppn_to_addr(satp.ppn);
+	if (rvbt_in_phys_mem(root))
+		rvbt_rmap_walk(root, 2, first, 0, phys, virt, n);
+}
+
+void rvbt_reverse_map(uint64_t satp_val, const uint64_t *phys, uint64_t *virt,
+		      int n)
+{
+	rvbt_reverse_map_from(satp_val, 0, phys, virt, n);
+}
+
+/*
+ * Same, but only the upper half of the space is walked, so a user
+ * mapping of a page never hides the kernel's view of it.
+ */
+void rvbt_reverse_map_kernel(uint64_t satp_val, const uint64_t *phys,
+			     uint64_t *virt, int n)
+{
+	rvbt_reverse_map_from(satp_val, 256, phys, virt, n);
 }
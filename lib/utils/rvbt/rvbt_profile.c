@@ -0,0 +1,162 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_string.h"
+#include "sbi/sbi_timer.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_profile.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+#include "sbi_utils/rvbt/rvbt_timer.h"
+
+static unsigned long rvbt_prof_off;
+static volatile bool rvbt_prof_active;
+/* Bumped on start and stop, each hart (re)arms when it notices */
+static volatile unsigned long rvbt_prof_gen;
+static uint64_t rvbt_prof_period;
+static int rvbt_prof_depth;
+
+static struct rvbt_prof_t *rvbt_prof_of(struct sbi_scratch *scratch)
+{
+	if (!rvbt_prof_off || !scratch)
+		return NULL;
+	return sbi_scratch_offset_ptr(scratch, rvbt_prof_off);
+}
+
+static void rvbt_prof_count(struct rvbt_prof_t *prof, uint64_t pc, bool self)
+{
+	int i, n;
+	struct rvbt_prof_entry_t *e;
+
+	n = (pc >> 1) * 0x9e3779b97f4a7c15UL >> 58;
+	for (i = 0; i < RVBT_PROF_PROBES; i++) {
+		e = &prof->tab[(n + i) % RVBT_PROF_BUCKETS];
+		if (e->pc != pc && e->total)
+			continue;
+		e->pc = pc;
+		e->total++;
+		if (self)
+			e->self++;
+		return;
+	}
+	prof->dropped++;
+}
+
+/* Firmware timer client, runs on the interrupted hart */
+static void rvbt_prof_tick(struct sbi_scratch *scratch)
+{
+	int i, n;
+	uint64_t ret[RVBT_PROF_MAX_DEPTH];
+	struct rvbt_prof_t *prof = rvbt_prof_of(scratch);
+	struct sbi_trap_regs *regs;
+
+	if (!prof || !rvbt_prof_active)
+		return;
+	regs = rvbt_trap_regs(scratch);
+	if (!regs) {
+		prof->skipped++;
+	} else {
+		prof->samples++;
+		rvbt_prof_count(prof, regs->mepc, true);
+		n = rvbt_unwind(regs->s0, csr_read(CSR_SATP), ret,
+				rvbt_prof_depth);
+		for (i = 0; i < n; i++)
+			rvbt_prof_count(prof, ret[i], false);
+	}
+	rvbt_timer_start(RVBT_TIMER_PROF,
+			 sbi_timer_value() + rvbt_prof_period);
+}
+
+int rvbt_prof_init(void)
+{
+	rvbt_prof_off = sbi_scratch_alloc_offset(sizeof(struct rvbt_prof_t));
+	if (!rvbt_prof_off)
+		return SBI_ENOMEM;
+	rvbt_timer_register(RVBT_TIMER_PROF, rvbt_prof_tick);
+	return 0;
+}
+
+/*
+ * Sample every hart at hz, capped so the profiler's share of each hart
+ * stays bounded. Each hart clears its histogram and arms its M-timer the
+ * next time it syncs with the breakpoint table.
+ */
+int rvbt_prof_start(unsigned long hz, int depth)
+{
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+
+	if (!rvbt_prof_off || !timer || !timer->timer_freq || !hz)
+		return SBI_EINVAL;
+	if (hz > RVBT_PROF_MAX_HZ)
+		hz = RVBT_PROF_MAX_HZ;
+	rvbt_prof_period = timer->timer_freq / hz;
+	rvbt_prof_depth	 = depth > RVBT_PROF_MAX_DEPTH ? RVBT_PROF_MAX_DEPTH :
+							 depth;
+	rvbt_prof_active = true;
+	rvbt_prof_gen++;
+	rvbt_breakpoint_changed(NULL);
+	return 0;
+}
+
+void rvbt_prof_stop(void)
+{
+	rvbt_prof_active = false;
+	rvbt_prof_gen++;
+	rvbt_breakpoint_changed(NULL);
+}
+
+void rvbt_prof_sync(struct rvbt_hart_t *hart)
+{
+	struct rvbt_prof_t *prof = rvbt_prof_of(sbi_scratch_thishart_ptr());
+
+	if (!prof || prof->gen == rvbt_prof_gen)
+		return;
+	prof->gen = rvbt_prof_gen;
+	if (!rvbt_prof_active) {
+		rvbt_timer_stop(RVBT_TIMER_PROF);
+		return;
+	}
+	prof->samples = prof->dropped = prof->skipped = 0;
+	sbi_memset(prof->tab, 0, sizeof(prof->tab));
+	rvbt_timer_start(RVBT_TIMER_PROF,
+			 sbi_timer_value() + rvbt_prof_period);
+}
+
+/* Top n PCs by self samples on every hart */
+void rvbt_prof_top(int n)
+{
+	u32 hartid;
+	int i, k, best;
+	uint32_t shown[RVBT_PROF_BUCKETS / 32 + 1];
+	struct rvbt_prof_t *prof;
+	struct rvbt_prof_entry_t *e;
+
+	sbi_printf("[Raven]: profiler %s\n", rvbt_prof_active ? "on" : "off");
+	for (hartid = 0; hartid <= sbi_scratch_last_hartid(); hartid++) {
+		prof = rvbt_prof_of(sbi_hartid_to_scratch(hartid));
+		if (!prof || !prof->samples)
+			continue;
+		sbi_printf("[Raven]: hart%u %lu samples, %lu in M-mode, %lu lost\n",
+			   hartid, prof->samples, prof->skipped,
+			   prof->dropped);
+		sbi_memset(shown, 0, sizeof(shown));
+		for (k = 0; k < n; k++) {
+			best = -1;
+			for (i = 0; i < RVBT_PROF_BUCKETS; i++) {
+				e = &prof->tab[i];
+				if (!e->self || (shown[i / 32] & (1U << (i % 32))))
+					continue;
+				if (best < 0 || e->self > prof->tab[best].self)
+					best = i;
+			}
+			if (best < 0)
+				break;
+			shown[best / 32] |= 1U << (best % 32);
+			e = &prof->tab[best];
+			sbi_printf("[Raven]:   0x%lx self %u (%lu%%) total %u\n",
+				   e->pc, e->self, e->self * 100UL / prof->samples,
+				   e->total);
+		}
+	}
+}
@@ -102,6 +102,18 @@ char* rvbt_gets() {
 }
 
 
+/* Bytes as they are, without the '\n' to "\r\n" mapping of sbi_putc() */
+void rvbt_write_raw(const void *buf, unsigned long len)
+{
+	const char *p = buf;
+	const struct sbi_console_device *con = sbi_console_get_device();
+
+	if (!con || !con->console_putc)
+		return;
+	while (len--)
+		con->console_putc(*p++);
+}
+
 int rvbt_serial_init() {
   uart16550_init(0x10000000);
   return 0;
@@ -0,0 +1,307 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/riscv_atomic.h"
+#include "sbi/riscv_barrier.h"
+#include "sbi/riscv_locks.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_domain.h"
+#include "sbi/sbi_ecall_interface.h"
+#include "sbi/sbi_hsm.h"
+#include "sbi/sbi_ipi.h"
+#include "sbi/sbi_timer.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+
+/* Give up on harts that have not parked after 1/RVBT_STOP_TIMEOUT_DIV s */
+#define RVBT_STOP_TIMEOUT_DIV 100
+#define RVBT_STOP_SPINS	      (1UL << 22)
+
+static int rvbt_event = -1;
+static int rvbt_sync_event = -1;
+/* Breakpoint generation when the current owner took the prompt */
+static unsigned long rvbt_stop_gen;
+static enum rvbt_smp_mode_t rvbt_mode = ALL_STOP;
+static spinlock_t rvbt_stop_lock = SPIN_LOCK_INITIALIZER;
+static volatile bool rvbt_stopping;
+static volatile unsigned long rvbt_release_gen;
+static atomic_t rvbt_parked = ATOMIC_INITIALIZER(0);
+static struct rvbt_smp_stats_t rvbt_smp_stats;
+
+/* Work handed to parked harts by rvbt_smp_parallel() */
+struct rvbt_smp_job_t {
+	void (*fn)(void *arg, unsigned long chunk);
+	void *arg;
+	unsigned long chunks;
+};
+static struct rvbt_smp_job_t rvbt_job;
+static volatile unsigned long rvbt_job_gen;
+/*
+ * Next chunk to claim, with the low bits of the job generation above it.
+ * A hart still on its way out of one job can only fail to claim from the
+ * next one, so it never runs a chunk twice or with the wrong fn.
+ */
+#define RVBT_JOB_SHIFT	  (BITS_PER_LONG / 2)
+#define RVBT_JOB_TAG(gen) ((gen) & ((1UL << (BITS_PER_LONG - RVBT_JOB_SHIFT)) - 1))
+static atomic_t rvbt_job_next = ATOMIC_INITIALIZER(0);
+static atomic_t rvbt_job_done = ATOMIC_INITIALIZER(0);
+
+/*
+ * Trap frame of the context the IPI interrupted. fw_base.S saves it right
+ * below the scratch area when the trap comes from S/U-mode; an M-mode
+ * context has no frame we can find.
+ */
+struct sbi_trap_regs *rvbt_trap_regs(struct sbi_scratch *scratch)
+{
+	ulong mpp = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+
+	if (mpp == PRV_M)
+		return NULL;
+	return (struct sbi_trap_regs *)((ulong)scratch - SBI_TRAP_REGS_SIZE);
+}
+
+/* Claim chunks of job gen until none are left or another job started */
+static void rvbt_job_work(unsigned long gen)
+{
+	unsigned long next, chunk;
+	struct rvbt_smp_job_t job;
+
+	smp_rmb();
+	job = rvbt_job;
+	smp_rmb();
+	while (1) {
+		next  = atomic_read(&rvbt_job_next);
+		chunk = next & ((1UL << RVBT_JOB_SHIFT) - 1);
+		if (next >> RVBT_JOB_SHIFT != RVBT_JOB_TAG(gen) ||
+		    chunk >= job.chunks)
+			break;
+		if (atomic_cmpxchg(&rvbt_job_next, next, next + 1) != next)
+			continue;
+		job.fn(job.arg, chunk);
+		atomic_add_return(&rvbt_job_done, 1);
+	}
+}
+
+/* Spin in M-mode until the stopping hart releases the world */
+static void rvbt_park(struct sbi_trap_regs *regs)
+{
+	struct rvbt_hart_t *hart = rvbt_hart();
+	unsigned long gen	 = rvbt_release_gen;
+	unsigned long job	 = rvbt_job_gen;
+
+	smp_rmb();
+	if (!rvbt_stopping)
+		return;
+	hart->parked_regs = regs;
+	atomic_add_return(&rvbt_parked, 1);
+	while (rvbt_release_gen == gen) {
+		if (rvbt_job_gen != job) {
+			job = rvbt_job_gen;
+			rvbt_job_work(job);
+		}
+		cpu_relax();
+	}
+	hart->parked_regs = NULL;
+	rvbt_sync_breakpoint();
+}
+
+static void rvbt_smp_process(struct sbi_scratch *scratch)
+{
+	rvbt_park(rvbt_trap_regs(scratch));
+}
+
+static struct sbi_ipi_event_ops rvbt_smp_ops = {
+	.name	 = "IPI_RVBT",
+	.process = rvbt_smp_process,
+};
+
+static void rvbt_sync_process(struct sbi_scratch *scratch)
+{
+	rvbt_sync_breakpoint();
+}
+
+static struct sbi_ipi_event_ops rvbt_sync_ops = {
+	.name	 = "IPI_RVBT_SYNC",
+	.process = rvbt_sync_process,
+};
+
+int rvbt_smp_init(void)
+{
+	int ret = sbi_ipi_event_create(&rvbt_sync_ops);
+
+	/* Without it the other harts still re-arm at their next trap */
+	if (ret >= 0)
+		rvbt_sync_event = ret;
+	ret = sbi_ipi_event_create(&rvbt_smp_ops);
+	if (ret < 0) {
+		sbi_printf("[Raven]: No IPI event left, non-stop only\n");
+		rvbt_mode = NON_STOP;
+		return ret;
+	}
+	rvbt_event = ret;
+	return 0;
+}
+
+void rvbt_smp_set_mode(enum rvbt_smp_mode_t mode)
+{
+	if (mode == ALL_STOP && rvbt_event < 0) {
+		sbi_printf("[Raven]: All-stop needs the Raven IPI event\n");
+		return;
+	}
+	rvbt_mode = mode;
+}
+
+/* Send an event to every started hart except ourselves */
+static long rvbt_send_others(u32 event)
+{
+	u32 i, self = current_hartid(), last = sbi_scratch_last_hartid();
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	ulong hbase, hmask;
+	long expected = 0;
+
+	for (hbase = 0; hbase <= last; hbase += BITS_PER_LONG) {
+		hmask = 0;
+		for (i = hbase; i <= last && i < hbase + BITS_PER_LONG; i++) {
+			if (i == self || sbi_hsm_hart_get_state(dom, i) !=
+						 SBI_HSM_STATE_STARTED)
+				continue;
+			hmask |= 1UL << (i - hbase);
+			expected++;
+		}
+		if (hmask)
+			sbi_ipi_send_many(hmask, hbase, event, NULL);
+	}
+	return expected;
+}
+
+/*
+ * Take ownership of the debugger. In all-stop mode every other started hart
+ * is parked before we return; in non-stop mode only the caller is held.
+ */
+void rvbt_smp_stop(struct sbi_trap_regs *regs)
+{
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+	u64 start, ticks, timeout = 0;
+	unsigned long spins;
+	long expected;
+
+	/* Another hart is at the prompt, wait our turn with the others */
+	while (!spin_trylock(&rvbt_stop_lock)) {
+		if (rvbt_stopping)
+			rvbt_park(regs);
+		cpu_relax();
+	}
+	rvbt_stop_gen = rvbt_breakpoint_gen();
+	if (rvbt_mode == NON_STOP)
+		return;
+
+	if (timer && timer->timer_freq)
+		timeout = timer->timer_freq / RVBT_STOP_TIMEOUT_DIV;
+	start = sbi_timer_value();
+	atomic_write(&rvbt_parked, 0);
+	rvbt_stopping = true;
+	smp_wmb();
+	expected = rvbt_send_others(rvbt_event);
+	for (spins = 0; atomic_read(&rvbt_parked) < expected; spins++) {
+		if (timeout ? sbi_timer_value() - start > timeout :
+			      spins > RVBT_STOP_SPINS)
+			break;
+		cpu_relax();
+	}
+	ticks = sbi_timer_value() - start;
+
+	rvbt_smp_stats.stops++;
+	rvbt_smp_stats.parked	  = atomic_read(&rvbt_parked);
+	rvbt_smp_stats.missed	  = expected - rvbt_smp_stats.parked;
+	rvbt_smp_stats.last_ticks = ticks;
+	if (ticks > rvbt_smp_stats.max_ticks)
+		rvbt_smp_stats.max_ticks = ticks;
+	if (rvbt_smp_stats.missed)
+		sbi_printf("[Raven]: %d harts did not stop\n",
+			   rvbt_smp_stats.missed);
+}
+
+/* Every other started hart is parked in M-mode right now */
+bool rvbt_smp_world_stopped(void)
+{
+	return rvbt_stopping && !rvbt_smp_stats.missed;
+}
+
+/*
+ * Run fn over chunks [0, chunks) and return once all are done. In a stopped
+ * world the parked harts pull chunks alongside us, otherwise we run them
+ * all ourselves. fn must be safe to run on any hart, and chunks must fit
+ * below RVBT_JOB_SHIFT bits.
+ */
+void rvbt_smp_parallel(void (*fn)(void *arg, unsigned long chunk), void *arg,
+		       unsigned long chunks)
+{
+	unsigned long gen = rvbt_job_gen + 1;
+
+	/*
+	 * Every chunk of the previous job has finished, but a parked hart
+	 * may still be reading its fields. Close it before they change.
+	 */
+	atomic_write(&rvbt_job_next, RVBT_JOB_TAG(gen) << RVBT_JOB_SHIFT |
+					     ((1UL << RVBT_JOB_SHIFT) - 1));
+	smp_wmb();
+	rvbt_job.fn	= fn;
+	rvbt_job.arg	= arg;
+	rvbt_job.chunks = chunks;
+	atomic_write(&rvbt_job_done, 0);
+	smp_wmb();
+	atomic_write(&rvbt_job_next, RVBT_JOB_TAG(gen) << RVBT_JOB_SHIFT);
+	smp_wmb();
+	rvbt_job_gen = gen;
+	rvbt_job_work(gen);
+	/* Chunks still running elsewhere */
+	while (atomic_read(&rvbt_job_done) < (long)chunks)
+		cpu_relax();
+}
+
+/*
+ * Let the world go. Parked harts re-arm on their way out; running ones
+ * (non-stop mode, or harts that never parked) get a sync event so new
+ * breakpoints take effect within one IPI latency.
+ */
+void rvbt_smp_release(void)
+{
+	rvbt_stopping = false;
+	smp_wmb();
+	rvbt_release_gen++;
+	if (rvbt_sync_event >= 0 && rvbt_breakpoint_gen() != rvbt_stop_gen)
+		rvbt_send_others(rvbt_sync_event);
+	spin_unlock(&rvbt_stop_lock);
+}
+
+static u64 rvbt_ticks_to_us(u64 ticks)
+{
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+
+	if (!timer || !timer->timer_freq)
+		return 0;
+	return ticks * 1000000 / timer->timer_freq;
+}
+
+void rvbt_smp_info(void)
+{
+	u32 i;
+	struct rvbt_hart_t *hart;
+	struct sbi_trap_regs *regs;
+
+	sbi_printf("[Raven]: mode %s, %d stops, %d parked, %d missed\n",
+		   rvbt_mode == ALL_STOP ? "all-stop" : "non-stop",
+		   rvbt_smp_stats.stops, rvbt_smp_stats.parked,
+		   rvbt_smp_stats.missed);
+	sbi_printf("[Raven]: stop latency last %lu ticks (%lu us), max %lu ticks (%lu us)\n",
+		   rvbt_smp_stats.last_ticks,
+		   rvbt_ticks_to_us(rvbt_smp_stats.last_ticks),
+		   rvbt_smp_stats.max_ticks,
+		   rvbt_ticks_to_us(rvbt_smp_stats.max_ticks));
+	for (i = 0; i <= sbi_scratch_last_hartid(); i++) {
+		hart = rvbt_hart_of(i);
+		regs = hart ? hart->parked_regs : NULL;
+		if (regs)
+			sbi_printf("[Raven]: hart %u parked at 0x%lx ra 0x%lx sp 0x%lx\n",
+				   i, regs->mepc, regs->ra, regs->sp);
+	}
+}
@@ -0,0 +1,244 @@
+#include "sbi/riscv_atomic.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_string.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+#include "sbi_utils/rvbt/rvbt_snap.h"
+
+#define XXH_P1 0x9E3779B185EBCA87ULL
+#define XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define XXH_P3 0x165667B19E3779F9ULL
+#define XXH_P4 0x85EBCA77C2B2AE63ULL
+
+/* Low half of each block's xxhash64, a changed block slips by at 2^-32 */
+static uint32_t rvbt_snap_hash[RVBT_SNAP_BLOCKS];
+static unsigned long rvbt_snap_changed[BITS_TO_LONGS(RVBT_SNAP_BLOCKS)];
+static struct rvbt_snap_range_t rvbt_snap_ranges[RVBT_SNAP_RANGES];
+static int rvbt_snap_range_cnt;
+static unsigned long rvbt_snap_blocks;
+static unsigned long rvbt_snap_shift;
+static bool rvbt_snap_diffing;
+static struct rvbt_snap_keep_t rvbt_snap_keep[RVBT_SNAP_KEEP];
+static int rvbt_snap_keep_cnt;
+
+static inline uint64_t rvbt_rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t rvbt_xxh_round(uint64_t acc, uint64_t in)
+{
+	return rvbt_rotl(acc + in * XXH_P2, 31) * XXH_P1;
+}
+
+static inline uint64_t rvbt_xxh_merge(uint64_t h, uint64_t v)
+{
+	return (h ^ rvbt_xxh_round(0, v)) * XXH_P1 + XXH_P4;
+}
+
+/* XXH64 with seed 0, for len a multiple of 32 and p 8-byte aligned */
+static uint64_t rvbt_xxh64(const uint64_t *p, uint64_t len)
+{
+	const uint64_t *end = p + len / 8;
+	uint64_t v1 = XXH_P1 + XXH_P2, v2 = XXH_P2, v3 = 0, v4 = -XXH_P1;
+	uint64_t h;
+
+	for (; p < end; p += 4) {
+		v1 = rvbt_xxh_round(v1, p[0]);
+		v2 = rvbt_xxh_round(v2, p[1]);
+		v3 = rvbt_xxh_round(v3, p[2]);
+		v4 = rvbt_xxh_round(v4, p[3]);
+	}
+	h = rvbt_rotl(v1, 1) + rvbt_rotl(v2, 7) + rvbt_rotl(v3, 12) +
+	    rvbt_rotl(v4, 18);
+	h = rvbt_xxh_merge(h, v1);
+	h = rvbt_xxh_merge(h, v2);
+	h = rvbt_xxh_merge(h, v3);
+	h = rvbt_xxh_merge(h, v4);
+	h += len;
+	h ^= h >> 33;
+	h *= XXH_P2;
+	h ^= h >> 29;
+	h *= XXH_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+static uint64_t rvbt_snap_block_addr(unsigned long idx)
+{
+	int i;
+
+	for (i = rvbt_snap_range_cnt - 1; i > 0; i--)
+		if (idx >= rvbt_snap_ranges[i].first)
+			break;
+	return rvbt_snap_ranges[i].base +
+	       ((idx - rvbt_snap_ranges[i].first) << rvbt_snap_shift);
+}
+
+/* Hash one chunk of blocks, flagging the ones that differ on a diff */
+static void rvbt_snap_chunk(void *arg, unsigned long chunk)
+{
+	unsigned long idx = chunk * RVBT_SNAP_CHUNK;
+	unsigned long end = MIN(idx + RVBT_SNAP_CHUNK, rvbt_snap_blocks);
+	uint32_t h;
+
+	for (; idx < end; idx++) {
+		h = rvbt_xxh64((const uint64_t *)rvbt_snap_block_addr(idx),
+			       1UL << rvbt_snap_shift);
+		if (rvbt_snap_diffing && h != rvbt_snap_hash[idx])
+			atomic_raw_set_bit(idx, rvbt_snap_changed);
+		rvbt_snap_hash[idx] = h;
+	}
+}
+
+static void rvbt_snap_run(bool diffing)
+{
+	rvbt_snap_diffing = diffing;
+	sbi_memset(rvbt_snap_changed, 0, sizeof(rvbt_snap_changed));
+	rvbt_smp_parallel(rvbt_snap_chunk, NULL,
+			  (rvbt_snap_blocks + RVBT_SNAP_CHUNK - 1) /
+				  RVBT_SNAP_CHUNK);
+}
+
+static void rvbt_snap_add(uint64_t base, uint64_t end)
+{
+	if (base >= end || rvbt_snap_range_cnt >= RVBT_SNAP_RANGES)
+		return;
+	rvbt_snap_ranges[rvbt_snap_range_cnt].base   = base;
+	rvbt_snap_ranges[rvbt_snap_range_cnt++].size = end - base;
+}
+
+/* Leave our own image out, its stacks and .bss change on every stop */
+static void rvbt_snap_add_clipped(uint64_t base, uint64_t end)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	uint64_t fw_base = scratch->fw_start;
+	uint64_t fw_end	 = scratch->fw_start + scratch->fw_size;
+
+	fw_base &= ~(RVBT_SNAP_BLOCK_MIN - 1);
+	fw_end = (fw_end + RVBT_SNAP_BLOCK_MIN - 1) & ~(RVBT_SNAP_BLOCK_MIN - 1);
+	if (base < fw_base)
+		rvbt_snap_add(base, MIN(end, fw_base));
+	if (fw_end < end)
+		rvbt_snap_add(MAX(base, fw_end), end);
+}
+
+/*
+ * Take a baseline of [base, base + size), or of all RAM when size is 0.
+ * The block size is the smallest power of two from 4K up that keeps the
+ * selection within the arena; a range's tail short of a block is left out.
+ */
+int rvbt_snap(uint64_t base, uint64_t size)
+{
+	int i;
+	unsigned long total = 0;
+
+	rvbt_snap_range_cnt = 0;
+	rvbt_snap_keep_cnt  = 0;
+	rvbt_snap_blocks    = 0;
+	if (size) {
+		base &= ~(RVBT_SNAP_BLOCK_MIN - 1UL);
+		size = (size + RVBT_SNAP_BLOCK_MIN - 1) &
+		       ~(RVBT_SNAP_BLOCK_MIN - 1UL);
+		if (!rvbt_in_phys_mem((void *)base) ||
+		    !rvbt_in_phys_mem((void *)(base + size - 1)))
+			return SBI_EINVAL;
+		rvbt_snap_add_clipped(base, base + size);
+	} else {
+		for (i = 0; i < mem_reg_cnt; i++)
+			rvbt_snap_add_clipped(mem_regs[i].base,
+					      mem_regs[i].base + mem_regs[i].size);
+	}
+	if (!rvbt_snap_range_cnt)
+		return SBI_EINVAL;
+
+	for (i = 0; i < rvbt_snap_range_cnt; i++)
+		total += rvbt_snap_ranges[i].size;
+	for (rvbt_snap_shift = 12;; rvbt_snap_shift++) {
+		rvbt_snap_blocks = 0;
+		for (i = 0; i < rvbt_snap_range_cnt; i++) {
+			rvbt_snap_ranges[i].first = rvbt_snap_blocks;
+			rvbt_snap_blocks += rvbt_snap_ranges[i].size >>
+					    rvbt_snap_shift;
+		}
+		if (rvbt_snap_blocks <= RVBT_SNAP_BLOCKS)
+			break;
+	}
+	rvbt_snap_run(false);
+	sbi_printf("[Raven]: snapshot of %lu bytes in %lu blocks of %lu bytes\n",
+		   total, rvbt_snap_blocks, 1UL << rvbt_snap_shift);
+	return 0;
+}
+
+/* Keep what a changed 4K block holds now for a later word-level diff */
+static void rvbt_snap_keep_block(uint64_t addr)
+{
+	struct rvbt_snap_keep_t *keep;
+
+	if (rvbt_snap_shift != 12 || rvbt_snap_keep_cnt >= RVBT_SNAP_KEEP)
+		return;
+	keep	   = &rvbt_snap_keep[rvbt_snap_keep_cnt++];
+	keep->base = addr;
+	sbi_memcpy(keep->data, (void *)addr, RVBT_SNAP_BLOCK_MIN);
+}
+
+/*
+ * Report runs of blocks that changed since the last snap or diff, then
+ * make the current contents the new baseline.
+ */
+void rvbt_snap_diff(void)
+{
+	unsigned long idx, run, changed = 0;
+	uint64_t start;
+
+	if (!rvbt_snap_blocks) {
+		sbi_printf("[Raven]: No snapshot to diff against\n");
+		return;
+	}
+	rvbt_snap_keep_cnt = 0;
+	rvbt_snap_run(true);
+	for (idx = 0; idx < rvbt_snap_blocks; idx += run) {
+		for (run = 0; idx + run < rvbt_snap_blocks &&
+			      __test_bit(idx + run, rvbt_snap_changed);
+		     run++)
+			rvbt_snap_keep_block(rvbt_snap_block_addr(idx + run));
+		if (!run) {
+			run = 1;
+			continue;
+		}
+		changed += run;
+		start = rvbt_snap_block_addr(idx);
+		sbi_printf("[Raven]: changed 0x%lx-0x%lx\n", start,
+			   rvbt_snap_block_addr(idx + run - 1) +
+				   (1UL << rvbt_snap_shift));
+	}
+	sbi_printf("[Raven]: %lu of %lu blocks changed, %d kept for word diffs\n",
+		   changed, rvbt_snap_blocks, rvbt_snap_keep_cnt);
+}
+
+/* Words of a kept block that changed since the diff that kept it */
+int rvbt_snap_words(uint64_t addr)
+{
+	int i, j, n = 0;
+	const uint64_t *now;
+	struct rvbt_snap_keep_t *keep;
+
+	for (i = 0; i < rvbt_snap_keep_cnt; i++) {
+		keep = &rvbt_snap_keep[i];
+		if (addr - keep->base >= RVBT_SNAP_BLOCK_MIN)
+			continue;
+		now = (const uint64_t *)keep->base;
+		for (j = 0; j < RVBT_SNAP_BLOCK_MIN / 8; j++) {
+			if (now[j] == keep->data[j])
+				continue;
+			sbi_printf("[Raven]: 0x%lx: 0x%016lx -> 0x%016lx\n",
+				   keep->base + j * 8, keep->data[j], now[j]);
+			n++;
+		}
+		sbi_printf("[Raven]: %d words changed\n", n);
+		return 0;
+	}
+	return SBI_ENOENT;
+}
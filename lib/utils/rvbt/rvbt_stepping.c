@@ -1,20 +1,18 @@
 #include "sbi_utils/rvbt/rvbt_stepping.h"
 #include "sbi/riscv_asm.h"
 #include "sbi/riscv_encoding.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
 #include "sbi_utils/rvbt/rvbt_serial.h"
 
-bool is_stepping[16];
-
 int rvbt_stepping(struct sbi_trap_regs *regs)
 {
-	int hartid = csr_read(CSR_MHARTID);
 	struct sbi_trap_info uptrap;
 	uint64_t virt_addr  = regs->mepc, phys_addr, next_phys, next_virt;
 	uint64_t satp_val   = csr_read(CSR_SATP);
 	uint32_t insn	    = sbi_get_insn(regs->mepc, &uptrap);
 	uint8_t offset	    = 0;
 	bool aligned	    = (regs->mepc & 0x03) == 0;
-	is_stepping[hartid] = true;
+	rvbt_hart()->stepping = true;
 	do {
 		if ((next_virt =
 			     rvbt_jump_decode(insn, virt_addr, regs, false))) {
@@ -47,6 +45,9 @@ int rvbt_stepping(struct sbi_trap_regs *regs)
 	else
 		pmp_set(1, PMP_A_NA4 | PMP_R | PMP_W, phys_addr, 2);
 	pmp_set(0, PMP_A_NA4 | PMP_R | PMP_W, phys_addr, 2);
+	/* Only the stepping entries may fault until the step lands */
+	for (int n = 2; n < RVBT_PMP_SLOTS; n++)
+		rvbt_clear_pmp_slot(n);
 	return 0;
 }
 
@@ -0,0 +1,70 @@
+#include "sbi/sbi_timer.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_timer.h"
+
+static rvbt_timer_fn_t rvbt_timer_fns[RVBT_TIMER_CLIENTS];
+
+/* Program the firmware event for the earliest client deadline */
+static void rvbt_timer_arm(struct rvbt_hart_t *hart)
+{
+	int i;
+	uint64_t next = -1ULL;
+
+	for (i = 0; i < RVBT_TIMER_CLIENTS; i++)
+		if (hart->timer_next[i] && hart->timer_next[i] < next)
+			next = hart->timer_next[i];
+	if (next == -1ULL)
+		sbi_timer_fw_event_stop();
+	else
+		sbi_timer_fw_event_start(next);
+}
+
+static void rvbt_timer_tick(void)
+{
+	int i;
+	uint64_t now		 = sbi_timer_value();
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	if (!hart)
+		return;
+	for (i = 0; i < RVBT_TIMER_CLIENTS; i++) {
+		if (!hart->timer_next[i] || hart->timer_next[i] > now)
+			continue;
+		hart->timer_next[i] = 0;
+		/* The client may start its next deadline */
+		if (rvbt_timer_fns[i])
+			rvbt_timer_fns[i](sbi_scratch_thishart_ptr());
+	}
+	rvbt_timer_arm(hart);
+}
+
+void rvbt_timer_init(void)
+{
+	sbi_timer_set_fw_handler(rvbt_timer_tick);
+}
+
+void rvbt_timer_register(enum rvbt_timer_client_t client, rvbt_timer_fn_t fn)
+{
+	rvbt_timer_fns[client] = fn;
+}
+
+/* Deadlines are absolute mtime values, 0 means none */
+void rvbt_timer_start(enum rvbt_timer_client_t client, uint64_t next)
+{
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	if (!hart)
+		return;
+	hart->timer_next[client] = next ? next : 1;
+	rvbt_timer_arm(hart);
+}
+
+void rvbt_timer_stop(enum rvbt_timer_client_t client)
+{
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	if (!hart)
+		return;
+	hart->timer_next[client] = 0;
+	rvbt_timer_arm(hart);
+}
@@ -0,0 +1,203 @@
+#include "sbi/riscv_encoding.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_scratch.h"
+#include "sbi/sbi_timer.h"
+#include "sbi/sbi_unpriv.h"
+#include "sbi_utils/rvbt/rvbt_init.h"
+#include "sbi_utils/rvbt/rvbt_stepping.h"
+#include "sbi_utils/rvbt/rvbt_trace.h"
+
+static unsigned long rvbt_trace_off;
+
+static struct rvbt_trace_t *rvbt_trace(void)
+{
+	if (!rvbt_trace_off)
+		return NULL;
+	return sbi_scratch_thishart_offset_ptr(rvbt_trace_off);
+}
+
+int rvbt_trace_init(void)
+{
+	rvbt_trace_off = sbi_scratch_alloc_offset(sizeof(struct rvbt_trace_t));
+	if (!rvbt_trace_off)
+		return SBI_ENOMEM;
+	return 0;
+}
+
+bool rvbt_trace_active(void)
+{
+	struct rvbt_trace_t *t = rvbt_trace();
+
+	return t && t->left;
+}
+
+static int rvbt_put_varint(uint8_t *buf, int64_t val)
+{
+	int n	   = 0;
+	uint64_t u = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+
+	while (u >= 0x80) {
+		buf[n++] = (u & 0x7f) | 0x80;
+		u >>= 7;
+	}
+	buf[n++] = u;
+	return n;
+}
+
+/* Decode one varint at ring offset *pos, advancing it */
+static int64_t rvbt_get_varint(struct rvbt_trace_t *t, uint32_t *pos)
+{
+	int shift = 0;
+	uint8_t b;
+	uint64_t u = 0;
+
+	do {
+		b = t->ring[*pos];
+		*pos = (*pos + 1) % RVBT_TRACE_RING_SIZE;
+		u |= (uint64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+static uint32_t rvbt_trace_decode(struct rvbt_trace_t *t, uint32_t pos,
+				  uint64_t *to, uint64_t *time, uint64_t *from)
+{
+	*from = *to + rvbt_get_varint(t, &pos);
+	*to   = *from + rvbt_get_varint(t, &pos);
+	*time += rvbt_get_varint(t, &pos);
+	return pos;
+}
+
+/* Overwrite the oldest record, folding it into the base values */
+static void rvbt_trace_drop(struct rvbt_trace_t *t)
+{
+	uint64_t from;
+	uint32_t pos = rvbt_trace_decode(t, t->head, &t->base_to,
+					 &t->base_time, &from);
+
+	t->used -= (pos + RVBT_TRACE_RING_SIZE - t->head) %
+		   RVBT_TRACE_RING_SIZE;
+	t->head = pos;
+	t->records--;
+}
+
+static void rvbt_trace_append(struct rvbt_trace_t *t, uint64_t from,
+			      uint64_t to, uint64_t time)
+{
+	uint8_t rec[30];
+	int i, len;
+
+	if (!t->records) {
+		t->base_to   = t->last_to   = from;
+		t->base_time = t->last_time = time;
+	}
+	len = rvbt_put_varint(rec, from - t->last_to);
+	len += rvbt_put_varint(rec + len, to - from);
+	len += rvbt_put_varint(rec + len, time - t->last_time);
+	while (RVBT_TRACE_RING_SIZE - t->used < len)
+		rvbt_trace_drop(t);
+	for (i = 0; i < len; i++)
+		t->ring[(t->head + t->used + i) % RVBT_TRACE_RING_SIZE] =
+			rec[i];
+	t->used += len;
+	t->records++;
+	t->last_to   = to;
+	t->last_time = time;
+}
+
+static void rvbt_trace_report(struct rvbt_trace_t *t)
+{
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+	uint64_t ticks = sbi_timer_value() - t->start, us = 0, rate = 0;
+
+	if (timer && timer->timer_freq && ticks) {
+		us   = ticks * 1000000 / timer->timer_freq;
+		rate = t->steps * timer->timer_freq / ticks;
+	}
+	sbi_printf("[Raven]: traced %lu insns, %lu taken branches in %lu us (%lu insn/s)\n",
+		   t->steps, t->branches, us, rate);
+}
+
+/*
+ * One lockstep step. Taken branches are recognised before the step since
+ * rvbt_stepping() emulates jumps and moves mepc itself. Fails once the
+ * window had to end early, leaving the hart where it is.
+ */
+static int rvbt_trace_advance(struct rvbt_trace_t *t,
+			      struct sbi_trap_regs *regs)
+{
+	struct sbi_trap_info uptrap;
+	uint64_t dest;
+	ulong insn = sbi_get_insn(regs->mepc, &uptrap);
+
+	if (uptrap.cause) {
+		t->left = 0;
+		rvbt_trace_report(t);
+		return SBI_EFAIL;
+	}
+	dest = rvbt_jump_decode(insn, regs->mepc, regs, false);
+	if (dest && dest != regs->mepc + INSN_LEN(insn)) {
+		rvbt_trace_append(t, regs->mepc, dest, sbi_timer_value());
+		t->branches++;
+	}
+	t->steps++;
+	if (!--t->left) {
+		rvbt_trace_report(t);
+		rvbt_resume(regs);
+		return 0;
+	}
+	if (rvbt_stepping(regs)) {
+		sbi_printf("[Raven]: Trace stopped, cannot step at 0x%lx\n",
+			   regs->mepc);
+		t->left = 0;
+		rvbt_trace_report(t);
+		return SBI_EFAIL;
+	}
+	return 0;
+}
+
+int rvbt_trace_step(struct sbi_trap_regs *regs)
+{
+	if (rvbt_trace_advance(rvbt_trace(), regs))
+		return rvbt_prompt(regs);
+	return 0;
+}
+
+/*
+ * Trace the next window instructions of this hart in lockstep. The
+ * caller returns to the traced code, each step lands in rvbt_trace_step().
+ */
+int rvbt_trace_start(struct sbi_trap_regs *regs, uint64_t window)
+{
+	struct rvbt_trace_t *t = rvbt_trace();
+
+	if (!t || !window)
+		return SBI_EINVAL;
+	t->left	    = window;
+	t->steps    = 0;
+	t->branches = 0;
+	t->start    = sbi_timer_value();
+	return rvbt_trace_advance(t, regs);
+}
+
+void rvbt_trace_dump(void)
+{
+	struct rvbt_trace_t *t = rvbt_trace();
+	uint64_t from, to, time;
+	uint32_t i, pos;
+
+	if (!t || !t->records) {
+		sbi_printf("[Raven]: Branch ring is empty\n");
+		return;
+	}
+	sbi_printf("[Raven]: %u branches, %u/%u bytes, oldest first\n",
+		   t->records, t->used, RVBT_TRACE_RING_SIZE);
+	to   = t->base_to;
+	time = t->base_time;
+	for (i = 0, pos = t->head; i < t->records; i++) {
+		pos = rvbt_trace_decode(t, pos, &to, &time, &from);
+		sbi_printf("[Raven]: 0x%lx -> 0x%lx @ %lu\n", from, to, time);
+	}
+}
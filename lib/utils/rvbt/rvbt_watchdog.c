@@ -0,0 +1,156 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/riscv_encoding.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_error.h"
+#include "sbi/sbi_timer.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_init.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_smp.h"
+#include "sbi_utils/rvbt/rvbt_timer.h"
+#include "sbi_utils/rvbt/rvbt_trace.h"
+#include "sbi_utils/rvbt/rvbt_watchdog.h"
+
+#define RVBT_WFI 0x10500073
+
+/* Bumped on start and stop, each hart (re)arms when it notices */
+static volatile unsigned long rvbt_wdog_gen;
+static uint64_t rvbt_wdog_period;
+static unsigned long rvbt_wdog_ms;
+static bool rvbt_wdog_prompt;
+static int rvbt_wdog_fired_cnt;
+
+/* Woken from the idle loop, S-mode interrupts are off around wfi */
+static bool rvbt_wdog_idle(struct sbi_trap_regs *regs)
+{
+	uint64_t phys = rvbt_mmu_translate(regs->mepc - 4, csr_read(CSR_SATP));
+
+	if (!rvbt_in_phys_mem((void *)phys) || (phys & 1))
+		return false;
+	return (((uint16_t *)phys)[0] | (uint32_t)((uint16_t *)phys)[1] << 16) ==
+	       RVBT_WFI;
+}
+
+/*
+ * A hart is making progress if the kernel reprogrammed its timer since
+ * the last check, or if it was caught outside S-mode, with interrupts
+ * enabled, or idling in wfi. Only an S-mode context that keeps
+ * interrupts off and never gets to its timer counts as stuck.
+ */
+static bool rvbt_wdog_progress(struct rvbt_hart_t *hart,
+			       struct sbi_trap_regs *regs)
+{
+	unsigned long events = sbi_timer_smode_starts();
+	ulong mpp;
+
+	if (events != hart->wdog_events) {
+		hart->wdog_events = events;
+		return true;
+	}
+	if (!regs)
+		return true;
+	mpp = (regs->mstatus & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+	return mpp != PRV_S || (regs->mstatus & MSTATUS_SIE) ||
+	       rvbt_wdog_idle(regs);
+}
+
+static void rvbt_wdog_report(struct sbi_trap_regs *regs)
+{
+	int i, n;
+	uint64_t ret[RVBT_WDOG_DEPTH];
+
+	sbi_printf("[Raven]: hart%u hard lockup, no timer progress for %lu ms, minstret %lu\n",
+		   current_hartid(), rvbt_wdog_ms, csr_read(CSR_MINSTRET));
+	rvbt_dump_regs(regs);
+	sbi_printf("[Raven]: backtrace:\n");
+	sbi_printf("[Raven]:   0x%lx\n", regs->mepc);
+	n = rvbt_unwind(regs->s0, csr_read(CSR_SATP), ret, RVBT_WDOG_DEPTH);
+	for (i = 0; i < n; i++)
+		sbi_printf("[Raven]:   0x%lx\n", ret[i]);
+	rvbt_trace_dump();
+}
+
+/* Firmware timer client, one check on the interrupted hart */
+static void rvbt_wdog_tick(struct sbi_scratch *scratch)
+{
+	struct rvbt_hart_t *hart   = rvbt_hart();
+	struct sbi_trap_regs *regs = rvbt_trap_regs(scratch);
+
+	if (!rvbt_wdog_period)
+		return;
+	rvbt_timer_start(RVBT_TIMER_WDOG,
+			 sbi_timer_value() + rvbt_wdog_period);
+	if (rvbt_wdog_progress(hart, regs)) {
+		hart->wdog_stuck = 0;
+		hart->wdog_fired = false;
+		return;
+	}
+	/* Report a lockup once, until the hart recovers */
+	if (++hart->wdog_stuck < RVBT_WDOG_CHECKS || hart->wdog_fired)
+		return;
+	hart->wdog_fired = true;
+	rvbt_wdog_fired_cnt++;
+	rvbt_wdog_report(regs);
+	if (rvbt_wdog_prompt)
+		rvbt_prompt(regs);
+}
+
+void rvbt_wdog_init(void)
+{
+	rvbt_timer_register(RVBT_TIMER_WDOG, rvbt_wdog_tick);
+}
+
+/*
+ * Flag a hart stuck for timeout_ms. It is checked RVBT_WDOG_CHECKS
+ * times per timeout, so a healthy hart takes a handful of extra M-timer
+ * interrupts per timeout and nothing else.
+ */
+int rvbt_wdog_start(unsigned long timeout_ms, bool prompt)
+{
+	const struct sbi_timer_device *timer = sbi_timer_get_device();
+
+	if (!timer || !timer->timer_freq || !timeout_ms)
+		return SBI_EINVAL;
+	rvbt_wdog_ms	 = timeout_ms;
+	rvbt_wdog_prompt = prompt;
+	rvbt_wdog_period = timer->timer_freq / 1000 * timeout_ms /
+			   RVBT_WDOG_CHECKS;
+	rvbt_wdog_gen++;
+	rvbt_breakpoint_changed(NULL);
+	return 0;
+}
+
+void rvbt_wdog_stop(void)
+{
+	rvbt_wdog_period = 0;
+	rvbt_wdog_gen++;
+	rvbt_breakpoint_changed(NULL);
+}
+
+void rvbt_wdog_sync(struct rvbt_hart_t *hart)
+{
+	if (hart->wdog_gen == rvbt_wdog_gen)
+		return;
+	hart->wdog_gen = rvbt_wdog_gen;
+	if (!rvbt_wdog_period) {
+		rvbt_timer_stop(RVBT_TIMER_WDOG);
+		return;
+	}
+	hart->wdog_events = sbi_timer_smode_starts();
+	hart->wdog_stuck  = 0;
+	hart->wdog_fired  = false;
+	rvbt_timer_start(RVBT_TIMER_WDOG,
+			 sbi_timer_value() + rvbt_wdog_period);
+}
+
+void rvbt_wdog_info(void)
+{
+	if (!rvbt_wdog_period)
+		sbi_printf("[Raven]: watchdog off, %d lockups seen\n",
+			   rvbt_wdog_fired_cnt);
+	else
+		sbi_printf("[Raven]: watchdog %lu ms, %s, %d lockups seen\n",
+			   rvbt_wdog_ms, rvbt_wdog_prompt ? "prompt" : "dump",
+			   rvbt_wdog_fired_cnt);
+}
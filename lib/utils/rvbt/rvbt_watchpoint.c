@@ -0,0 +1,210 @@
+#include "sbi/riscv_asm.h"
+#include "sbi/riscv_encoding.h"
+#include "sbi/sbi_console.h"
+#include "sbi/sbi_unpriv.h"
+#include "sbi_utils/rvbt/rvbt_breakpoint.h"
+#include "sbi_utils/rvbt/rvbt_hart.h"
+#include "sbi_utils/rvbt/rvbt_init.h"
+#include "sbi_utils/rvbt/rvbt_memory.h"
+#include "sbi_utils/rvbt/rvbt_watchpoint.h"
+
+union rvbt_reg_data {
+	u8 data_bytes[8];
+	ulong data_ulong;
+};
+
+/* A decoded integer load or store */
+struct rvbt_access_t {
+	ulong insn;
+	ulong insn_len;
+	int len;
+	int shift;
+	bool store;
+	union rvbt_reg_data val;
+};
+
+static bool rvbt_decode_load(ulong insn, struct rvbt_access_t *acc)
+{
+	acc->store = false;
+	acc->shift = 0;
+	acc->insn  = insn;
+	if ((insn & INSN_MASK_LB) == INSN_MATCH_LB) {
+		acc->len   = 1;
+		acc->shift = 8 * (sizeof(ulong) - 1);
+	} else if ((insn & INSN_MASK_LBU) == INSN_MATCH_LBU) {
+		acc->len = 1;
+	} else if ((insn & INSN_MASK_LH) == INSN_MATCH_LH) {
+		acc->len   = 2;
+		acc->shift = 8 * (sizeof(ulong) - 2);
+	} else if ((insn & INSN_MASK_LHU) == INSN_MATCH_LHU) {
+		acc->len = 2;
+	} else if ((insn & INSN_MASK_LW) == INSN_MATCH_LW) {
+		acc->len   = 4;
+		acc->shift = 8 * (sizeof(ulong) - 4);
+	} else if ((insn & INSN_MASK_LWU) == INSN_MATCH_LWU) {
+		acc->len = 4;
+	} else if ((insn & INSN_MASK_LD) == INSN_MATCH_LD) {
+		acc->len = 8;
+	} else if ((insn & INSN_MASK_C_LD) == INSN_MATCH_C_LD) {
+		acc->len  = 8;
+		acc->insn = RVC_RS2S(insn) << SH_RD;
+	} else if ((insn & INSN_MASK_C_LDSP) == INSN_MATCH_C_LDSP &&
+		   ((insn >> SH_RD) & 0x1f)) {
+		acc->len = 8;
+	} else if ((insn & INSN_MASK_C_LW) == INSN_MATCH_C_LW) {
+		acc->len   = 4;
+		acc->shift = 8 * (sizeof(ulong) - 4);
+		acc->insn  = RVC_RS2S(insn) << SH_RD;
+	} else if ((insn & INSN_MASK_C_LWSP) == INSN_MATCH_C_LWSP &&
+		   ((insn >> SH_RD) & 0x1f)) {
+		acc->len   = 4;
+		acc->shift = 8 * (sizeof(ulong) - 4);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static bool rvbt_decode_store(ulong insn, struct sbi_trap_regs *regs,
+			      struct rvbt_access_t *acc)
+{
+	acc->store	     = true;
+	acc->insn	     = insn;
+	acc->val.data_ulong = GET_RS2(insn, regs);
+	if ((insn & INSN_MASK_SB) == INSN_MATCH_SB) {
+		acc->len = 1;
+	} else if ((insn & INSN_MASK_SH) == INSN_MATCH_SH) {
+		acc->len = 2;
+	} else if ((insn & INSN_MASK_SW) == INSN_MATCH_SW) {
+		acc->len = 4;
+	} else if ((insn & INSN_MASK_SD) == INSN_MATCH_SD) {
+		acc->len = 8;
+	} else if ((insn & INSN_MASK_C_SD) == INSN_MATCH_C_SD) {
+		acc->len	     = 8;
+		acc->val.data_ulong = GET_RS2S(insn, regs);
+	} else if ((insn & INSN_MASK_C_SDSP) == INSN_MATCH_C_SDSP) {
+		acc->len	     = 8;
+		acc->val.data_ulong = GET_RS2C(insn, regs);
+	} else if ((insn & INSN_MASK_C_SW) == INSN_MATCH_C_SW) {
+		acc->len	     = 4;
+		acc->val.data_ulong = GET_RS2S(insn, regs);
+	} else if ((insn & INSN_MASK_C_SWSP) == INSN_MATCH_C_SWSP) {
+		acc->len	     = 4;
+		acc->val.data_ulong = GET_RS2C(insn, regs);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Perform the access on behalf of S/U-mode. M-mode is not subject to
+ * Raven's unlocked PMP entries, so the physical access goes through.
+ */
+static bool rvbt_emulate_access(struct rvbt_access_t *acc, ulong addr,
+				struct sbi_trap_regs *regs)
+{
+	int i;
+	uint64_t satp = csr_read(CSR_SATP);
+	uint8_t *phys = (uint8_t *)rvbt_mmu_translate(addr, satp);
+
+	if (!rvbt_in_phys_mem(phys) ||
+	    rvbt_mmu_translate(addr + acc->len - 1, satp) !=
+		    (uint64_t)phys + acc->len - 1)
+		return false;
+	if (acc->store) {
+		for (i = 0; i < acc->len; i++)
+			phys[i] = acc->val.data_bytes[i];
+	} else {
+		acc->val.data_ulong = 0;
+		for (i = 0; i < acc->len; i++)
+			acc->val.data_bytes[i] = phys[i];
+		SET_RD(acc->insn, regs,
+		       ((long)(acc->val.data_ulong << acc->shift)) >>
+			       acc->shift);
+	}
+	regs->mepc += acc->insn_len;
+	return true;
+}
+
+static bool rvbt_watch_hit(ulong addr, int len, bool store)
+{
+	int i;
+	uint64_t base;
+	struct rvbt_breakpoint_t *bp;
+	struct rvbt_hart_t *hart = rvbt_hart();
+
+	for (i = 0; i < RVBT_MAX_BREAKPOINTS; i++) {
+		bp = &rvbt_breakpoints[i];
+		if (!bp->enabled || rvbt_bp_pending(hart, i) ||
+		    (bp->type != DATA && bp->type != WATCH))
+			continue;
+		if (!(bp->access &
+		      (store ? RVBT_WATCH_WRITE : RVBT_WATCH_READ)))
+			continue;
+		base = bp->virt_addr;
+		if (bp->type == DATA)
+			base &= ~(bp->size - 1);
+		if (addr < base + bp->size && base < addr + len)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Load/store access fault handler. Faults outside Raven's watched
+ * regions are left to the caller. Faults inside a region but outside
+ * the watched bytes, or of an access kind that is not watched, are
+ * emulated in M-mode and never reach the debugger.
+ */
+bool rvbt_watch_access(ulong mcause, ulong mtval, struct sbi_trap_regs *regs)
+{
+	int i;
+	bool store = mcause == CAUSE_STORE_ACCESS, ours = false;
+	uint64_t phys_addr, base, end;
+	ulong insn;
+	struct rvbt_access_t acc;
+	struct sbi_trap_info uptrap;
+	struct rvbt_hart_t *hart = rvbt_hart();
+	struct rvbt_bp_stats_t *stats;
+
+	if (!hart)
+		return false;
+	stats	  = &hart->stats;
+	phys_addr = rvbt_mmu_translate(mtval, csr_read(CSR_SATP));
+	for (i = 0; i < RVBT_MAX_BREAKPOINTS && !ours; i++) {
+		if (!rvbt_breakpoints[i].enabled ||
+		    rvbt_bp_pending(hart, i) ||
+		    (rvbt_breakpoints[i].type != DATA &&
+		     rvbt_breakpoints[i].type != WATCH) ||
+		    !rvbt_watch_range(i, hart, &base, &end))
+			continue;
+		ours = base <= phys_addr && phys_addr < end;
+	}
+	if (!ours)
+		return false;
+
+	insn = sbi_get_insn(regs->mepc, &uptrap);
+	if (uptrap.cause)
+		return false;
+	if (store ? rvbt_decode_store(insn, regs, &acc) :
+		    rvbt_decode_load(insn, &acc)) {
+		acc.insn_len = INSN_LEN(insn);
+		if (!rvbt_watch_hit(mtval, acc.len, store) &&
+		    rvbt_emulate_access(&acc, mtval, regs)) {
+			stats->watch_filtered++;
+			return true;
+		}
+	} else if (!rvbt_watch_hit(mtval, 1, store)) {
+		/* AMOs and FP accesses run natively with the PMP disarmed */
+		stats->watch_filtered++;
+		rvbt_resume(regs);
+		return true;
+	}
+
+	stats->watch_hits++;
+	sbi_printf("[Raven]: Watchpoint hit, %s at 0x%lx\n",
+		   store ? "store" : "load", mtval);
+	rvbt_prompt(regs);
+	return true;
+}
@@ -185,9 +185,14 @@ static int generic_domains_init(void)
 
 static u64 generic_tlbr_flush_limit(void)
 {
+	u64 limit;
+
 	if (generic_plat && generic_plat->tlbr_flush_limit)
 		return generic_plat->tlbr_flush_limit(generic_plat_match);
-	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
+	if (!fdt_parse_tlb_range_flush_limit(sbi_scratch_thishart_arg1_ptr(),
+					     &limit))
+		return limit;
+	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_CALIBRATE;
 }
 
 static int generic_pmu_init(void)
@@ -0,0 +1,31 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host stand-in for the firmware atomics, built on the compiler builtins.
+ */
+
+#ifndef __RISCV_ATOMIC_H__
+#define __RISCV_ATOMIC_H__
+
+typedef struct {
+	volatile long counter;
+} atomic_t;
+
+#define ATOMIC_INIT(_lptr, val) (_lptr)->counter = (val)
+
+static inline long atomic_read(atomic_t *atom)
+{
+	return __atomic_load_n(&atom->counter, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_write(atomic_t *atom, long value)
+{
+	__atomic_store_n(&atom->counter, value, __ATOMIC_SEQ_CST);
+}
+
+static inline long atomic_cmpxchg(atomic_t *atom, long oldval, long newval)
+{
+	return __sync_val_compare_and_swap(&atom->counter, oldval, newval);
+}
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host stand-in for the firmware barriers.
+ */
+
+#ifndef __RISCV_BARRIER_H__
+#define __RISCV_BARRIER_H__
+
+#include <sched.h>
+
+#define mb()		__sync_synchronize()
+#define smp_mb()	__sync_synchronize()
+#define smp_rmb()	__sync_synchronize()
+#define smp_wmb()	__sync_synchronize()
+
+/* The host may run more producers than it has CPUs, let them progress */
+#define cpu_relax()	sched_yield()
+
+#endif
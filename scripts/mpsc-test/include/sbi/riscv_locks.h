@@ -0,0 +1,34 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host stand-in for the firmware ticket lock, so sbi_fifo.c runs as the
+ * baseline with the same fairness it has on the harts.
+ */
+
+#ifndef __RISCV_LOCKS_H__
+#define __RISCV_LOCKS_H__
+
+#include <sched.h>
+
+typedef struct {
+	volatile unsigned short owner;
+	volatile unsigned short next;
+} spinlock_t;
+
+#define SPIN_LOCK_INIT(x)	(x).owner = (x).next = 0
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	unsigned short me = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+
+	/* More producers than CPUs, let the owner run */
+	while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != me)
+		sched_yield();
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+#endif
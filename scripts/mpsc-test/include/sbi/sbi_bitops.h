@@ -0,0 +1,12 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host stand-in for the firmware bit helpers.
+ */
+
+#ifndef __SBI_BITOPS_H__
+#define __SBI_BITOPS_H__
+
+#define BITS_PER_LONG (8 * sizeof(long))
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host stand-in for the firmware string helpers.
+ */
+
+#ifndef __SBI_STRING_H__
+#define __SBI_STRING_H__
+
+#include <string.h>
+
+#define sbi_memset memset
+#define sbi_memcpy memcpy
+
+#endif
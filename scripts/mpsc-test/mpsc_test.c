@@ -0,0 +1,235 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Host-side stress test and benchmark of lib/sbi/sbi_mpsc.c, with the
+ * spinlocked lib/sbi/sbi_fifo.c it replaced as the baseline.
+ *
+ * Every producer enqueues a numbered sequence of entries and now and then
+ * merges one into an entry still queued instead, the way tlb_update()
+ * does. The single consumer checks that nothing is lost, duplicated or
+ * reordered per producer, and that every merge is seen exactly once.
+ * Both queues run the same workload and their cost per entry is printed
+ * side by side.
+ *
+ * Usage: mpsc_test [producers] [entries per producer] [ring size]
+ * Without a producer count it sweeps 2, 4, ... 64 producers.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sbi/riscv_barrier.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_fifo.h>
+#include <sbi/sbi_mpsc.h>
+
+#define MPSC_TEST_MAX_PRODUCERS 64
+
+struct mpsc_test_entry {
+	long producer;
+	long seq;
+	long merged;
+};
+
+/* The operations tlb_update() and its consumer use, for either queue */
+struct mpsc_test_ops {
+	const char *name;
+	size_t (*mem_size)(u16 entries, u16 entry_size);
+	void (*init)(void *q, void *mem, u16 entries, u16 entry_size);
+	int (*enqueue)(void *q, void *data);
+	int (*dequeue)(void *q, void *data);
+	int (*update)(void *q, void *in, int (*fptr)(void *in, void *data));
+	int (*is_empty)(void *q);
+};
+
+static size_t mpsc_test_mpsc_size(u16 entries, u16 entry_size)
+{
+	return SBI_MPSC_MEM_SIZE((size_t)entries, entry_size);
+}
+
+static size_t mpsc_test_fifo_size(u16 entries, u16 entry_size)
+{
+	return (size_t)entries * entry_size;
+}
+
+static const struct mpsc_test_ops mpsc_test_mpsc = {
+	.name	  = "mpsc",
+	.mem_size = mpsc_test_mpsc_size,
+	.init	  = (void *)sbi_mpsc_init,
+	.enqueue  = (void *)sbi_mpsc_enqueue,
+	.dequeue  = (void *)sbi_mpsc_dequeue,
+	.update	  = (void *)sbi_mpsc_inplace_update,
+	.is_empty = (void *)sbi_mpsc_is_empty,
+};
+
+static const struct mpsc_test_ops mpsc_test_fifo = {
+	.name	  = "fifo",
+	.mem_size = mpsc_test_fifo_size,
+	.init	  = (void *)sbi_fifo_init,
+	.enqueue  = (void *)sbi_fifo_enqueue,
+	.dequeue  = (void *)sbi_fifo_dequeue,
+	.update	  = (void *)sbi_fifo_inplace_update,
+	.is_empty = (void *)sbi_fifo_is_empty,
+};
+
+static const struct mpsc_test_ops *test_ops;
+static union {
+	struct sbi_mpsc mpsc;
+	struct sbi_fifo fifo;
+} test_q;
+static long test_count;
+static long test_enqueued;
+static long test_merges;
+static long test_full;
+
+static int mpsc_test_merge(void *in, void *data)
+{
+	struct mpsc_test_entry *entry = data;
+
+	entry->merged++;
+	return SBI_FIFO_UPDATED;
+}
+
+static void *mpsc_test_producer(void *arg)
+{
+	long i, id = (long)arg;
+	unsigned int seed = id + 1;
+	struct mpsc_test_entry entry;
+
+	for (i = 0; i < test_count; i++) {
+		entry.producer = id;
+		entry.seq      = i;
+		entry.merged   = 0;
+		if (!(rand_r(&seed) & 3) &&
+		    test_ops->update(&test_q, &entry, mpsc_test_merge) ==
+			    SBI_FIFO_UPDATED) {
+			__atomic_add_fetch(&test_merges, 1, __ATOMIC_RELAXED);
+			continue;
+		}
+		while (test_ops->enqueue(&test_q, &entry) == SBI_ENOSPC) {
+			__atomic_add_fetch(&test_full, 1, __ATOMIC_RELAXED);
+			cpu_relax();
+		}
+		__atomic_add_fetch(&test_enqueued, 1, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+static double mpsc_test_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Returns 0 when the run checks out, *ns is the cost per entry */
+static int mpsc_test_run(const struct mpsc_test_ops *ops, long producers,
+			 long count, u16 entries, double *ns)
+{
+	long i, got = 0, merged = 0, total = producers * count;
+	long last[MPSC_TEST_MAX_PRODUCERS];
+	pthread_t threads[MPSC_TEST_MAX_PRODUCERS];
+	struct mpsc_test_entry entry;
+	void *mem;
+	double start, secs;
+	int rc = 0;
+
+	mem = malloc(ops->mem_size(entries, sizeof(entry)));
+	if (!mem)
+		return 1;
+	test_ops = ops;
+	ops->init(&test_q, mem, entries, sizeof(entry));
+	test_count    = count;
+	test_enqueued = 0;
+	test_merges   = 0;
+	test_full     = 0;
+	for (i = 0; i < producers; i++)
+		last[i] = -1;
+
+	start = mpsc_test_now();
+	for (i = 0; i < producers; i++)
+		pthread_create(&threads[i], NULL, mpsc_test_producer,
+			       (void *)i);
+	/* Every sequence number ends up either dequeued or merged */
+	while (got + __atomic_load_n(&test_merges, __ATOMIC_RELAXED) < total) {
+		if (ops->dequeue(&test_q, &entry)) {
+			cpu_relax();
+			continue;
+		}
+		got++;
+		merged += entry.merged;
+		/* Keep draining on a failure, the producers would block */
+		if (entry.producer < 0 || entry.producer >= producers) {
+			printf("%s: entry from unknown producer %ld\n",
+			       ops->name, entry.producer);
+			rc = 1;
+			continue;
+		}
+		if (entry.seq <= last[entry.producer]) {
+			printf("%s: producer %ld: entry %ld after %ld\n",
+			       ops->name, entry.producer, entry.seq,
+			       last[entry.producer]);
+			rc = 1;
+		}
+		last[entry.producer] = entry.seq;
+	}
+	for (i = 0; i < producers; i++)
+		pthread_join(threads[i], NULL);
+	secs = mpsc_test_now() - start;
+	/* Merges land in entries that may still be queued */
+	while (!ops->dequeue(&test_q, &entry)) {
+		got++;
+		merged += entry.merged;
+	}
+	if (!ops->is_empty(&test_q) || got != test_enqueued ||
+	    merged != test_merges) {
+		printf("%s: %ld dequeued of %ld, %ld merges seen of %ld\n",
+		       ops->name, got, test_enqueued, merged, test_merges);
+		rc = 1;
+	}
+
+	*ns = secs * 1e9 / total;
+	free(mem);
+	return rc;
+}
+
+/* The baseline first, then the ring, on the same workload */
+static int mpsc_test_compare(long producers, long count, u16 entries)
+{
+	double fifo_ns, mpsc_ns;
+	int rc;
+
+	rc = mpsc_test_run(&mpsc_test_fifo, producers, count, entries,
+			   &fifo_ns);
+	rc |= mpsc_test_run(&mpsc_test_mpsc, producers, count, entries,
+			    &mpsc_ns);
+	printf("%2ld producers: fifo %8.1f ns/entry, mpsc %8.1f ns/entry, "
+	       "%5.2fx %s\n",
+	       producers, fifo_ns, mpsc_ns, fifo_ns / mpsc_ns,
+	       rc ? "FAIL" : "ok");
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	long producers = argc > 1 ? atol(argv[1]) : 0;
+	long count     = argc > 2 ? atol(argv[2]) : 20000;
+	long entries   = argc > 3 ? atol(argv[3]) : 8;
+	int rc	       = 0;
+
+	if (producers < 0 || producers > MPSC_TEST_MAX_PRODUCERS ||
+	    count <= 0 || entries <= 0 || entries > 0xffff) {
+		fprintf(stderr, "usage: %s [1-%d producers] [count] [entries]\n",
+			argv[0], MPSC_TEST_MAX_PRODUCERS);
+		return 2;
+	}
+	if (producers)
+		return mpsc_test_compare(producers, count, entries);
+	for (producers = 2; producers <= MPSC_TEST_MAX_PRODUCERS;
+	     producers *= 2)
+		rc |= mpsc_test_compare(producers, count, entries);
+	return rc;
+}